@@ -15,9 +15,12 @@ extern "C" {
 esp_err_t app_init(void);
 
 /**
- * @brief 应用主循环（需要从主任务定期调用）
+ * @brief 应用主循环（事件驱动，不返回）
+ *
+ * 在 app_task 中调用。阻塞等待按键 / BLE 消息 / 保存请求 / 震动与 LED 动画
+ * 等事件源的任务通知，空闲时无限期阻塞，不产生周期唤醒。
  */
-void app_loop(void);
+void app_run(void);
 
 /**
  * @brief 应用清理（系统重启前调用）
@@ -2,6 +2,7 @@
 #include "board.h"
 #include "ble_manager.h"
 #include "ui.h"
+#include "storage.h"
 #include "esp_log.h"
 #include "esp_err.h"
 #include "esp_timer.h"
@@ -10,6 +11,9 @@
 
 static const char* APP_TAG = "app";
 
+/* 一整批消息在 UI 锁内追加，待写队列须同时容纳它与之前尚未刷新的变更 */
+_Static_assert(STORAGE_MSGLOG_PENDING_MAX >= 2 * BLE_MESSAGE_BATCH_MAX, "消息日志待写队列容纳不下批量消息");
+
 /* ========== 配置常量 ========== */
 #define BLE_ADV_RETRY_COUNT      3
 #define BLE_ADV_RETRY_DELAY_MS   200
@@ -22,9 +26,56 @@ static const char* APP_TAG = "app";
 // 任务句柄（用于后续管理）
 static TaskHandle_t s_gui_task_handle = NULL;
 
-/* BLE 状态缓存（用于日志记录） */
-static bool s_last_connected = false;
-static bool s_last_advertising = false;
+/* ========== 事件驱动主循环 ========== */
+/* app_task 阻塞在任务通知上，各事件源在有工作时置位对应 bit 唤醒它；
+ * 只有震动 / LED 动画进行中才会按其下一步的时间点定时唤醒，空闲时无限期阻塞。 */
+#define APP_EVT_KEY       (1u << 0)   // 按键事件入队
+#define APP_EVT_BLE_MSG   (1u << 1)   // BLE 消息入队
+#define APP_EVT_SAVE      (1u << 2)   // UI 有待写入的 NVS 数据
+#define APP_EVT_HAPTIC    (1u << 3)   // 震动模式启动
+#define APP_EVT_LED       (1u << 4)   // LED 效果变更
+#define APP_EVT_BEACON    (1u << 5)   // 定时刷新状态信标（电量）
+#define APP_EVT_COUNT     6
+#define APP_EVT_ALL       ((1u << APP_EVT_COUNT) - 1)
+
+static TaskHandle_t s_app_task_handle = NULL;
+
+/* 状态信标中的电量在静止时也要更新：app_task 空闲时无限期阻塞，
+ * 由独立的长周期定时器唤醒，不依赖其他事件或功耗统计报告 */
+#define BEACON_REFRESH_INTERVAL_MS  (5 * 60 * 1000)
+
+static esp_timer_handle_t s_beacon_timer = NULL;
+
+/* ========== 功耗统计 ========== */
+/* 按设备状态累计 PM 锁持有占比（芯片被强制保持唤醒的时间）和 app_task 唤醒次数，
+ * 在 app_task 被唤醒时顺带检查是否到达报告间隔（不为报告单独唤醒），
+ * 用于对照电流表测量结果发现功耗回退 */
+#define PM_REPORT_INTERVAL_MS    60000
+
+typedef enum {
+    APP_PM_STATE_MAIN = 0,        // UI 活动
+    APP_PM_STATE_STANDBY,         // 待机（屏保/关屏），未连接
+    APP_PM_STATE_CONNECTED_IDLE,  // 待机且 BLE 已连接
+    APP_PM_STATE_COUNT
+} app_pm_state_t;
+
+typedef struct {
+    uint64_t time_us;           // 处于该状态的累计时长
+    uint64_t awake_us;          // 其间任一 PM 锁被持有的时长
+    uint32_t wakeups;           // app_task 唤醒次数
+} app_pm_state_stats_t;
+
+static const char* const s_pm_state_names[APP_PM_STATE_COUNT] = {
+    "main", "standby", "connected-idle",
+};
+static const char* const s_evt_names[APP_EVT_COUNT] = {
+    "key", "ble", "save", "haptic", "led", "beacon",
+};
+static app_pm_state_stats_t s_pm_state_stats[APP_PM_STATE_COUNT];
+static app_pm_state_t s_pm_state = APP_PM_STATE_MAIN;
+static board_pm_stats_t s_pm_last;
+static uint32_t s_evt_counts[APP_EVT_COUNT];
+static uint32_t s_timeout_wakeups;  // 由动画定时而非事件唤醒的次数
 
 /** 蓝牙连接状态变化回调 */
 static void ble_connection_changed(bool connected)
@@ -37,6 +88,53 @@ static void ble_connection_changed(bool connected)
     ui_request_redraw();
 }
 
+/* ===================== 事件源 → app_task 通知 ===================== */
+
+static void app_notify(uint32_t bits)
+{
+    if (s_app_task_handle != NULL) {
+        xTaskNotify(s_app_task_handle, bits, eSetBits);
+    }
+}
+
+static void on_key_event(void)   { app_notify(APP_EVT_KEY); }
+static void on_ble_message(void) { app_notify(APP_EVT_BLE_MSG); }
+static void on_save_request(void){ app_notify(APP_EVT_SAVE); }
+static void on_haptic_event(void){ app_notify(APP_EVT_HAPTIC); }
+static void on_led_event(void)   { app_notify(APP_EVT_LED); }
+static void on_beacon_timer(void* arg) { (void)arg; app_notify(APP_EVT_BEACON); }
+
+static void beacon_timer_start(void)
+{
+    const esp_timer_create_args_t timer_args = {
+        .callback = on_beacon_timer,
+        .arg = NULL,
+        .name = "beacon",
+        .dispatch_method = ESP_TIMER_TASK,
+        .skip_unhandled_events = true,
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &s_beacon_timer);
+    if (ret == ESP_OK) {
+        ret = esp_timer_start_periodic(s_beacon_timer, (uint64_t)BEACON_REFRESH_INTERVAL_MS * 1000);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(APP_TAG, "信标刷新定时器启动失败: %s", esp_err_to_name(ret));
+    }
+}
+
+/** BLE 一帧中的消息作为一次收件箱操作交给 UI */
+static void on_ble_messages(const ble_message_t* msgs, size_t count)
+{
+    ui_message_ref_t refs[BLE_MESSAGE_BATCH_MAX];
+    if (count > BLE_MESSAGE_BATCH_MAX) {
+        count = BLE_MESSAGE_BATCH_MAX;
+    }
+    for (size_t i = 0; i < count; i++) {
+        refs[i] = (ui_message_ref_t){ msgs[i].sender, msgs[i].body, msgs[i].timestamp };
+    }
+    ui_show_messages(refs, (int)count);
+}
+
 /* ===================== GUI 任务 ===================== */
 
 static void ui_redraw_callback(void) {
@@ -53,7 +151,10 @@ static void gui_task(void* pvParameters)
     uint32_t sleep_ms = ui_tick();
 
     for (;;) {
-        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(sleep_ms));
+        /* 屏幕关闭时无限期阻塞，由按键/消息触发的 ui_request_redraw 唤醒 */
+        TickType_t wait = (sleep_ms == UI_TICK_SLEEP_FOREVER) ? portMAX_DELAY
+                                                              : pdMS_TO_TICKS(sleep_ms);
+        ulTaskNotifyTake(pdTRUE, wait);
         sleep_ms = ui_tick();
     }
 }
@@ -74,8 +175,15 @@ esp_err_t app_init(void)
         ESP_LOGE(APP_TAG, "BLE msg queue init failed: %s", esp_err_to_name(ret));
         return ret;
     }
-    ble_manager_set_message_callback(ui_show_message_with_timestamp);
+    ble_manager_set_message_batch_callback(on_ble_messages);
     ble_manager_set_connection_callback(ble_connection_changed);
+    ble_manager_set_pending_callback(on_ble_message);
+
+    /* 事件源注册：有工作时通知 app_task */
+    board_key_set_event_cb(on_key_event);
+    board_vibrate_set_event_cb(on_haptic_event);
+    board_leds_set_event_cb(on_led_event);
+    ui_set_save_callback(on_save_request);
 
     /* 3. UI 初始化 */
     ui_init();
@@ -98,51 +206,199 @@ esp_err_t app_init(void)
     return ESP_OK;
 }
 
-static void update_ble_state_logging(void)
+static app_pm_state_t current_pm_state(void)
 {
-    bool connected = ble_manager_is_connected();
-    bool advertising = (ble_manager_get_state() == BLE_STATE_ADVERTISING);
+    if (!ui_is_in_standby()) {
+        return APP_PM_STATE_MAIN;
+    }
+    return ble_manager_is_connected() ? APP_PM_STATE_CONNECTED_IDLE : APP_PM_STATE_STANDBY;
+}
 
-    if (connected != s_last_connected || advertising != s_last_advertising) {
-        s_last_connected = connected;
-        s_last_advertising = advertising;
+/** 将上次采样以来的时间和 PM 锁持有时长计入当前状态 */
+static void pm_accumulate(void)
+{
+    board_pm_stats_t cur;
+    board_pm_get_stats(&cur);
+    if (s_pm_last.uptime_us != 0) {
+        app_pm_state_stats_t* st = &s_pm_state_stats[s_pm_state];
+        st->time_us += cur.uptime_us - s_pm_last.uptime_us;
+        st->awake_us += cur.any_held_us - s_pm_last.any_held_us;
+        st->wakeups++;
     }
+    s_pm_last = cur;
+    s_pm_state = current_pm_state();
 }
 
-/* ===================== 应用主循环 ===================== */
-void app_loop(void)
+static void pm_report(void)
+{
+    ESP_LOGI(APP_TAG, "PM report (light sleep %s):", s_pm_last.enabled ? "on" : "off");
+    for (int i = 0; i < APP_PM_STATE_COUNT; i++) {
+        const app_pm_state_stats_t* st = &s_pm_state_stats[i];
+        if (st->time_us == 0) continue;
+        ESP_LOGI(APP_TAG, "  %-14s time=%llus awake=%llu.%llu%% wakeups=%lu (%llu.%02llu/s)",
+                 s_pm_state_names[i],
+                 st->time_us / 1000000ULL,
+                 st->awake_us * 100ULL / st->time_us,
+                 (st->awake_us * 1000ULL / st->time_us) % 10ULL,
+                 (unsigned long)st->wakeups,
+                 (uint64_t)st->wakeups * 1000000ULL / st->time_us,
+                 ((uint64_t)st->wakeups * 100000000ULL / st->time_us) % 100ULL);
+    }
+    ESP_LOGI(APP_TAG, "  events key=%lu ble=%lu save=%lu haptic=%lu led=%lu timeout=%lu",
+             (unsigned long)s_evt_counts[0], (unsigned long)s_evt_counts[1],
+             (unsigned long)s_evt_counts[2], (unsigned long)s_evt_counts[3],
+             (unsigned long)s_evt_counts[4], (unsigned long)s_timeout_wakeups);
+    for (int i = 0; i < BOARD_PM_LOCK_COUNT; i++) {
+        ESP_LOGI(APP_TAG, "  lock %-8s acquired=%lu held=%llums",
+                 board_pm_lock_name((board_pm_lock_id_t)i),
+                 (unsigned long)s_pm_last.locks[i].acquire_count,
+                 s_pm_last.locks[i].held_us / 1000ULL);
+    }
+
+    board_key_stats_t ks;
+    board_key_get_stats(&ks);
+    if (ks.events > 0) {
+        ESP_LOGI(APP_TAG, "  key latency avg=%lluus max=%luus (%lu events, %lu irq)",
+                 ks.total_latency_us / ks.events, (unsigned long)ks.max_latency_us,
+                 (unsigned long)ks.events, (unsigned long)ks.wakeups);
+    }
+
+    ble_manager_stats_t bs;
+    ble_manager_get_stats(&bs);
+    if (bs.callbacks > 0) {
+        ESP_LOGI(APP_TAG, "  ble cb avg=%lluus max=%luus (%lu) queue=%lu/%lu worker max=%luus",
+                 bs.callback_total_us / bs.callbacks, (unsigned long)bs.callback_max_us,
+                 (unsigned long)bs.callbacks, (unsigned long)bs.queue_depth,
+                 (unsigned long)bs.queue_high_water, (unsigned long)bs.worker_max_us);
+        ESP_LOGI(APP_TAG, "  ble rx=%lu drop=%lu frames=%lu resync=%luB ack=%lu/%lu nack=%lu credit=%lu",
+                 (unsigned long)bs.rx_writes, (unsigned long)bs.rx_dropped,
+                 (unsigned long)bs.frames, (unsigned long)bs.resync_bytes,
+                 (unsigned long)bs.ack_frames, (unsigned long)bs.acked_messages,
+                 (unsigned long)bs.nacks_sent, (unsigned long)bs.credit_updates);
+        ESP_LOGI(APP_TAG, "  ble tx frames=%lu notify=%lu drop=%lu congest=%lu",
+                 (unsigned long)bs.tx_frames, (unsigned long)bs.tx_notifies,
+                 (unsigned long)bs.tx_dropped, (unsigned long)bs.tx_congestions);
+    }
+
+    ble_manager_link_info_t li;
+    if (ble_manager_get_link_info(&li) == ESP_OK) {
+        ESP_LOGI(APP_TAG, "  ble link phy=%u/%u dle=%u/%u mtu=%u",
+                 li.tx_phy, li.rx_phy, li.tx_data_len, li.rx_data_len, li.mtu);
+    }
+    if (bs.conn_updates > 0 || bs.conn_update_failures > 0) {
+        ESP_LOGI(APP_TAG, "  ble conn fast=%lus idle=%lus updates=%lu failed=%lu",
+                 (unsigned long)(bs.conn_fast_ms / 1000), (unsigned long)(bs.conn_idle_ms / 1000),
+                 (unsigned long)bs.conn_updates, (unsigned long)bs.conn_update_failures);
+    }
+    ESP_LOGI(APP_TAG, "  ble adv fast=%lus slow=%lus bg=%lus cfg=%lu reconnect=%lu last=%lums max=%lums",
+             (unsigned long)(bs.adv_fast_ms / 1000), (unsigned long)(bs.adv_slow_ms / 1000),
+             (unsigned long)(bs.adv_background_ms / 1000), (unsigned long)bs.adv_data_configs,
+             (unsigned long)bs.reconnects, (unsigned long)bs.reconnect_last_ms,
+             (unsigned long)bs.reconnect_max_ms);
+    ESP_LOGI(APP_TAG, "  ble beacon updates=%lu conn=%lu idle conn=%lu stranger=%lu dup=%lu",
+             (unsigned long)bs.beacon_updates, (unsigned long)bs.connections,
+             (unsigned long)bs.idle_connections, (unsigned long)bs.stranger_connections,
+             (unsigned long)bs.duplicates);
+
+    storage_msglog_stats_t ms;
+    storage_msglog_get_stats(&ms);
+    uint32_t ops = ms.appends + ms.deletes + ms.read_marks;
+    if (ops > 0) {
+        uint64_t written = ms.append_bytes + ms.delete_bytes + ms.read_bytes;
+        ESP_LOGI(APP_TAG, "  msglog add=%lu (%lluB) del=%lu (%lluB) read=%lu (%lluB) evict=%lu",
+                 (unsigned long)ms.appends, ms.append_bytes,
+                 (unsigned long)ms.deletes, ms.delete_bytes,
+                 (unsigned long)ms.read_marks, ms.read_bytes,
+                 (unsigned long)ms.evictions);
+        ESP_LOGI(APP_TAG, "  msglog written=%lluB +gc %lluB (%lu runs) vs legacy %lluB, live=%lu dead=%lu",
+                 written, ms.compact_bytes, (unsigned long)ms.compactions,
+                 ms.legacy_equiv_bytes, (unsigned long)ms.live_records,
+                 (unsigned long)ms.dead_records);
+    }
+}
+
+static TickType_t ms_to_wait_ticks(uint32_t ms)
+{
+    if (ms == BOARD_TICK_IDLE) {
+        return portMAX_DELAY;
+    }
+    // 向上取整，避免不足一个 tick 的等待变成 0 导致空转
+    return (TickType_t)((ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+}
+
+/** 处理一轮事件，返回距下一次必须处理的时间 (ms)，BOARD_TICK_IDLE 表示无 */
+static uint32_t app_dispatch(uint32_t events)
 {
-    /* 1. 按键轮询 */
-    board_key_t key = board_key_poll();
-    if (key != BOARD_KEY_NONE) {
-        ui_on_key(key);
+    if (events & APP_EVT_KEY) {
+        board_key_t key;
+        while ((key = board_key_poll()) != BOARD_KEY_NONE) {
+            ui_on_key(key);
+        }
+    }
+
+    if (events & APP_EVT_BLE_MSG) {
+        ble_manager_process_pending_messages();
     }
 
-    /* 2. BLE 消息处理 */
-    ble_manager_process_pending_messages();
+    // 按键 / 消息处理可能产生新的保存请求，其通知会在下一轮到达；此处顺带写入
+    if (events & (APP_EVT_SAVE | APP_EVT_KEY | APP_EVT_BLE_MSG)) {
+        ui_flush_pending_saves();
+    }
 
-    /* 3. 延迟 NVS 持久化 */
-    ui_flush_pending_saves();
+    // 未读数 / 收件箱序号 / 电量可能变化，同步到广播中的状态信标（未变化时无开销）
+    if (events & (APP_EVT_SAVE | APP_EVT_KEY | APP_EVT_BLE_MSG | APP_EVT_BEACON)) {
+        ble_manager_update_status_beacon();
+    }
 
-    /* 4. 震动马达更新 */
-    board_vibrate_tick();
+    // 震动与 LED 动画每次唤醒都推进一次，自行给出下一步的时间
+    uint32_t next_ms = board_vibrate_tick();
+    uint32_t led_ms = board_leds_tick();
+    if (led_ms < next_ms) {
+        next_ms = led_ms;
+    }
+    return next_ms;
+}
 
-    /* 5. LED 状态机轮询 */
-    board_leds_tick();
+/* ===================== 应用主循环 ===================== */
+void app_run(void)
+{
+    s_app_task_handle = xTaskGetCurrentTaskHandle();
+    beacon_timer_start();
 
-    /* 6. 非关键路径 (200ms) */
-    static uint32_t s_slow_tick_time = 0;
-    uint32_t now = board_time_ms();
-    if (now - s_slow_tick_time >= 200) {
-        s_slow_tick_time = now;
-        ble_manager_poll();
-        update_ble_state_logging();
+    // 首轮处理所有事件源，补上任务创建前已发生的事件
+    uint32_t events = APP_EVT_ALL;
+    uint32_t report_time = board_time_ms();
+
+    for (;;) {
+        for (int i = 0; i < APP_EVT_COUNT; i++) {
+            if (events & (1u << i)) s_evt_counts[i]++;
+        }
+
+        uint32_t next_ms = app_dispatch(events);
+
+        pm_accumulate();
+        uint32_t now = board_time_ms();
+        if (now - report_time >= PM_REPORT_INTERVAL_MS) {
+            report_time = now;
+            pm_report();
+        }
+
+        events = 0;
+        if (xTaskNotifyWait(0, UINT32_MAX, &events, ms_to_wait_ticks(next_ms)) != pdTRUE) {
+            s_timeout_wakeups++;
+        }
     }
 }
 
 /* ===================== 应用清理 ===================== */
 void app_cleanup(void)
 {
+    if (s_beacon_timer != NULL) {
+        esp_timer_stop(s_beacon_timer);
+        esp_timer_delete(s_beacon_timer);
+        s_beacon_timer = NULL;
+    }
+
     if (s_gui_task_handle != NULL) {
         vTaskDelete(s_gui_task_handle);
         s_gui_task_handle = NULL;
@@ -6,7 +6,10 @@
  * 协议格式：[协议头 (0xB0)][时间戳 (4)][消息类型 (1)][数据长度 (2)][数据 (N)][校验和 (1)]
  *
  * 自包含的 BLE 消息处理：
- *   - 在蓝牙任务中接收数据 → 入队（非阻塞）
+ *   - 蓝牙回调只把 RX 写入拷贝到缓冲池并投递给 ble_worker 任务，不做解析和 NVS 操作
+ *   - ble_worker 中：流式组装器切分完整帧（写入边界与帧边界无关）→ 解析 → 绑定 / 时间同步 / 入队
+ *   - 发往手机的通知经 TX 调度器排队：控制帧优先，按 MTU 分片，拥塞或未订阅时暂停
+ *   - 入队后通过 pending 回调唤醒 app_task
  *   - 在 app_task 中 ble_manager_process_pending_messages() → 出队并调用回调
  * 
  * 安全启动机制：
@@ -31,32 +34,234 @@
 #include "nvs_flash.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/ringbuf.h"
 #include "freertos/event_groups.h"
 #include "esp_timer.h"
 #include <string.h>
 #include <time.h>
 #include <sys/time.h>
+#include <sys/param.h>
 
 
 /* ================== 绑定相关常量 ================== */
 #define BINDING_NVS_NAMESPACE "ble_binding"
 #define BINDING_NVS_KEY "bound_device"
 #define BINDING_NVS_NAME_KEY "bound_name"
+#define BINDING_NVS_TYPE_KEY "bound_type"
+#define BINDING_NVS_TABLE_KEY "bonds"
 
 
 /* ================== 消息队列配置 ================== */
 
-/** 单条消息事件结构体 */
+/**
+ * 单条消息记录（变长）：text 中依次存放以 '\0' 结尾的发送者和正文。
+ * 一个环形缓冲区项包含一帧（TEXT 或 BATCH）的全部记录，每条记录按 4 字节对齐依次排列。
+ * 记录直接在环形缓冲区内构造，消费者拿到的是指向缓冲区的指针，不再整块拷贝。
+ */
 typedef struct {
-    char     sender[32];   /**< 发送者名称 */
-    char     body[128];    /**< 消息正文 */
     uint32_t timestamp;    /**< Unix 时间戳 */
-} ble_msg_event_t;
+    uint8_t  sender_len;   /**< 发送者长度（不含 '\0'） */
+    uint8_t  body_len;     /**< 正文长度（不含 '\0'） */
+    uint8_t  flags;        /**< MSG_REC_FLAG_* */
+    char     text[];       /**< sender '\0' body '\0' */
+} ble_msg_record_t;
+
+/** 发送者与上一条记录相同（text 中的发送者为空） */
+#define MSG_REC_FLAG_SAME_SENDER  0x01
+
+/** 发送者最大长度（协议中 sender_len 须小于 65） */
+#define MSG_SENDER_MAX   64
+
+#define MSG_RECORD_SIZE(sender_len, body_len) \
+    ((sizeof(ble_msg_record_t) + (sender_len) + 1 + (body_len) + 1 + 3) & ~(size_t)3)
+
+/**
+ * 单个环形缓冲区项的最大占用（含 8 字节项头）。单条 TEXT 最长约 324 字节；
+ * BATCH 每条记录比帧内多出至多 16 字节（记录头、'\0'、对齐与默认发送者 "App"）
+ */
+#define MSG_ITEM_MAX     (8 + BIPUPU_MAX_DATA_LENGTH + 16 * BIPUPU_BATCH_MAX_RECORDS)
+
+/**
+ * 环形缓冲区大小：短消息可缓存 60 条以上，满长度（240 字节正文）的消息 6 条
+ */
+#define MSG_RING_SIZE    2048
+
+/**
+ * 接收额度上限（按帧计）：按最大项计算并预留一项给回绕浪费的空间，
+ * 保证手机在额度内发送的帧一定能入队
+ */
+#define MSG_CREDITS_MAX  (MSG_RING_SIZE / MSG_ITEM_MAX - 1)
+
+_Static_assert(BLE_MESSAGE_BATCH_MAX == BIPUPU_BATCH_MAX_RECORDS, "批量消息上限不一致");
+
+static RingbufHandle_t s_msg_ring = NULL;
+
+/* 已入队但尚未被 app_task 取走的项数 */
+static uint32_t s_msg_inflight = 0;
+static portMUX_TYPE s_msg_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/* 已向手机通告额度为 0（或发送了 NACK），消费后需要主动下发 CREDIT */
+static volatile bool s_flow_paused = false;
+
+
+/* ================== 合并 ACK ================== */
+
+/** 本设备支持的特性 */
+#define DEVICE_FEATURES      (BIPUPU_FEATURE_BATCH_ACK | BIPUPU_FEATURE_BATCH_TEXT | BIPUPU_FEATURE_SEQ)
+
+/** 合并窗口：第一条待确认消息最多等待这么久（约一个连接间隔） */
+#define ACK_COALESCE_US      30000
+
+/* 以下状态只在 ble_worker 任务中访问 */
+static uint8_t  s_peer_features = 0;      /* HELLO 协商结果，断开后清零 */
+static uint32_t s_ack_ids[BIPUPU_BATCH_ACK_MAX];
+static uint8_t  s_ack_count = 0;
+static int64_t  s_ack_first_us = 0;
+
+
+/* ================== RX 帧组装 ================== */
+
+/** 长写入（Prepare Write）缓冲区大小，与 RX 特征值最大长度一致 */
+#define PREP_WRITE_BUF_SIZE  512
+
+/* 手机端的写入不必与帧边界对齐：普通写入与执行后的长写入都送入同一个流式组装器。
+ * 组装器只在 ble_worker 任务中访问 */
+static bipupu_assembler_t s_rx_assembler;
+
+static uint8_t  s_prep_buf[PREP_WRITE_BUF_SIZE];
+static uint16_t s_prep_len = 0;
+static esp_gatt_status_t s_prep_status = ESP_GATT_OK;
+
+/* Prepare Write 响应需要回显数据，结构体约 600 字节，避免放在蓝牙任务栈上 */
+static esp_gatt_rsp_t s_prep_rsp;
+
+
+/* ================== BLE 工作任务 ================== */
+
+/** RX 缓冲池：每块容纳一次写入（ATT 属性值最长 512 字节） */
+#define RX_POOL_BLOCKS       4
+#define RX_BLOCK_SIZE        512
 
-/** 队列深度：缓冲最多 8 条消息（内存开销约 1.3 KB） */
-#define MSG_QUEUE_DEPTH  8
+/** 命令队列深度：RX_DATA 最多占用 RX_POOL_BLOCKS 项，其余留给控制命令 */
+#define BLE_CMD_QUEUE_DEPTH  (RX_POOL_BLOCKS + 4)
 
-static QueueHandle_t s_msg_queue = NULL;
+typedef enum {
+    BLE_CMD_RX_DATA,     /**< block 中有 len 字节待组装 */
+    BLE_CMD_LINK_RESET,  /**< 连接变化，丢弃未完成的收发帧 */
+    BLE_CMD_SEND_CREDIT, /**< 手机启用通知，下发当前额度 */
+    BLE_CMD_TX_KICK,     /**< TX 队列有新数据或拥塞解除 */
+    BLE_CMD_CONN_PARAMS, /**< 连接参数更新完成 */
+} ble_cmd_type_t;
+
+typedef struct {
+    uint8_t  type;       /**< ble_cmd_type_t */
+    uint8_t  block;      /**< RX 缓冲池块号 */
+    uint16_t len;
+} ble_cmd_t;
+
+static uint8_t s_rx_pool[RX_POOL_BLOCKS][RX_BLOCK_SIZE];
+static QueueHandle_t s_rx_free_queue = NULL;   /* 空闲块号 */
+static QueueHandle_t s_cmd_queue = NULL;
+static TaskHandle_t s_worker_handle = NULL;
+
+/* 回调耗时等统计由蓝牙任务写入，工作任务统计由 ble_worker 写入 */
+static ble_manager_stats_t s_stats = {0};
+
+
+/* ================== TX 调度 ================== */
+
+/** 发送优先级：控制帧（ACK / NACK / CREDIT / HELLO）总是先于批量数据发送 */
+typedef enum {
+    TX_PRIO_CTRL,
+    TX_PRIO_BULK,
+} tx_prio_t;
+
+#define TX_CTRL_RING_SIZE    512
+#define TX_BULK_RING_SIZE    1024
+
+/** 发送失败（协议栈缓冲区满）后的重试间隔 */
+#define TX_RETRY_MS          20
+
+/** 未协商 MTU 时的默认值 */
+#define ATT_DEFAULT_MTU      23
+
+static RingbufHandle_t s_tx_ctrl_ring = NULL;
+static RingbufHandle_t s_tx_bulk_ring = NULL;
+
+/* 以下由 ble_worker 独占：正在分片发送的帧 */
+static uint8_t* s_tx_cur = NULL;
+static RingbufHandle_t s_tx_cur_ring = NULL;
+static size_t s_tx_cur_len = 0;
+static size_t s_tx_cur_off = 0;
+static bool s_tx_retry = false;
+
+/* 由蓝牙回调更新 */
+static volatile bool s_tx_congested = false;
+static volatile bool s_notify_enabled = false;
+static volatile uint16_t s_mtu = ATT_DEFAULT_MTU;
+
+
+/* ================== 链路优化 ================== */
+
+/** 连接后请求的链路层数据长度（DLE 上限） */
+#define LINK_DATA_LEN_MAX    251
+
+/** 未启用 DLE 时的链路层数据长度 */
+#define LINK_DATA_LEN_DEFAULT 27
+
+/* 由 GAP 回调更新，断开时复位 */
+static volatile uint8_t s_link_tx_phy = ESP_BLE_GAP_PHY_1M;
+static volatile uint8_t s_link_rx_phy = ESP_BLE_GAP_PHY_1M;
+static volatile uint16_t s_link_tx_len = LINK_DATA_LEN_DEFAULT;
+static volatile uint16_t s_link_rx_len = LINK_DATA_LEN_DEFAULT;
+
+/* 连接建立后置位，首个连接参数更新事件到达时再请求 PHY / DLE（BTC 任务内读写） */
+static bool s_link_optimize_pending = false;
+
+
+/* ================== 连接参数策略 ================== */
+
+/* 有收发流量时使用短间隔，空闲 CONN_IDLE_TIMEOUT_MS 后切换到长间隔 + 从机延迟。
+ * 参数取值满足 iOS 配件设计规范（间隔 ≥ 15ms，max × (latency + 1) ≤ 2s，超时 ≤ 6s） */
+typedef enum {
+    CONN_MODE_NONE,      /**< 未连接 / 参数未知 */
+    CONN_MODE_FAST,      /**< 传输中：15-30ms，无延迟 */
+    CONN_MODE_IDLE,      /**< 空闲：100-200ms，从机延迟 4 */
+    CONN_MODE_COUNT,
+} conn_mode_t;
+
+typedef struct {
+    uint16_t min_int;    /**< 单位 1.25ms */
+    uint16_t max_int;
+    uint16_t latency;
+    uint16_t timeout;    /**< 单位 10ms */
+} conn_mode_params_t;
+
+static const conn_mode_params_t s_conn_mode_params[CONN_MODE_COUNT] = {
+    [CONN_MODE_FAST] = { .min_int = 0x0C, .max_int = 0x18, .latency = 0, .timeout = 400 },
+    [CONN_MODE_IDLE] = { .min_int = 0x50, .max_int = 0xA0, .latency = 4, .timeout = 600 },
+};
+
+static const char* const s_conn_mode_names[CONN_MODE_COUNT] = { "none", "fast", "idle" };
+
+#define CONN_IDLE_TIMEOUT_MS 5000    /**< 无流量多久后放宽连接参数 */
+#define CONN_RETRY_MS        5000    /**< 参数更新被拒绝后的重试间隔 */
+
+/* 以下由 ble_worker 独占 */
+static conn_mode_t s_conn_requested = CONN_MODE_NONE;
+static bool s_conn_update_pending = false;
+static int64_t s_conn_last_activity_us = 0;
+static int64_t s_conn_retry_us = 0;
+
+/* 实际生效的模式与进入时间（ms），ble_manager_get_stats 读取时需加锁 */
+static portMUX_TYPE s_conn_mux = portMUX_INITIALIZER_UNLOCKED;
+static conn_mode_t s_conn_mode = CONN_MODE_NONE;
+static uint32_t s_conn_mode_since_ms = 0;
+
+/* GAP 回调写入的更新结果，经 BLE_CMD_CONN_PARAMS 交给 ble_worker */
+static volatile esp_bt_status_t s_conn_evt_status;
+static volatile uint16_t s_conn_evt_interval;
+static volatile uint16_t s_conn_evt_latency;
 
 
 /* ================== 安全启动相关常量 ================== */
@@ -93,17 +298,79 @@ static const uint8_t nus_tx_uuid[16] = {
 #define ADV_INTERVAL_MAX_MS         1000
 #define ADV_DURATION_SEC            0
 
+/* 分级广播：开机 / 断开后先快速广播便于立即回连，随后逐级放宽间隔以省电 */
+#define ADV_FAST_DURATION_MS        30000   /**< 快速广播持续时间 */
+#define ADV_SLOW_DURATION_MS        300000  /**< 慢速广播持续时间，之后转入后台广播 */
+#define ADV_BACKGROUND_MIN_MS       2000
+#define ADV_BACKGROUND_MAX_MS       2500
+
+/** 广播间隔换算为 0.625ms 单位 */
+#define ADV_INTERVAL_UNITS(ms)      ((uint16_t)((ms) * 1000 / 625))
+
 
 /* ================== 全局状态 ================== */
 static const char *TAG = "BLE";
-static char s_bound_device_addr[18] = {0};
-static char s_bound_device_name[32] = {0};
-static bool s_is_bound = false;
+static bool s_is_bound = false;             /* 绑定表非空 */
+
+/* 绑定表：原始 6 字节地址 + 元数据，整表作为一个 blob 存入 NVS */
+#define BOND_BLOB_VERSION       1
+#define BOND_ADDR_TYPE_UNKNOWN  0xFF            /* 旧版本保存的绑定没有地址类型 */
+
+typedef struct __attribute__((packed)) {
+    uint8_t  addr[6];
+    uint8_t  addr_type;                     /* esp_ble_addr_type_t 或 BOND_ADDR_TYPE_UNKNOWN */
+    uint8_t  used;
+    uint32_t last_seen;                     /* 最近连接时间（Unix 秒） */
+    uint32_t msg_count;                     /* 累计收到的消息条数 */
+    char     name[BLE_BOND_NAME_MAX];
+} bond_entry_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t version;
+    uint8_t count;
+    bond_entry_t entries[BLE_MAX_BONDS];
+} bond_blob_t;
+
+static bond_entry_t s_bonds[BLE_MAX_BONDS];
+static portMUX_TYPE s_bond_mux = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool s_bonds_dirty = false;  /* 元数据有未保存的变化 */
+
+/* 当前连接在绑定表中的槽位与授权结果，连接时匹配一次，包处理路径只读缓存 */
+static volatile int s_conn_bond = -1;
+static volatile bool s_conn_authorized = false;
+
+
+/* ================== 重复消息抑制 ================== */
+
+/* 每个绑定槽位记住最近 SEQ_WINDOW_BITS 个序号：top 为收下的最大序号，
+ * bits 以 seq % SEQ_WINDOW_BITS 为下标环形存放 (top - 64, top] 内已收下的序号。
+ * 落后 top 超过窗口的序号视为手机序号重新开始，按新消息处理；每次 BINDING_INFO 都清空窗口。
+ * 窗口只在内存中，重启后为空 */
+#define SEQ_WINDOW_BITS 64
+
+typedef struct {
+    uint32_t top;
+    uint64_t bits;
+    bool valid;
+} seq_window_t;
+
+/* 以下由 ble_worker 独占；最后一项给未绑定的连接，对端地址变化时清空 */
+static seq_window_t s_seq_windows[BLE_MAX_BONDS + 1];
+static esp_bd_addr_t s_seq_guest_addr = {0};
 
 /* 当前连接的对端地址 */
 static esp_bd_addr_t s_current_remote_addr = {0};
+static esp_ble_addr_type_t s_current_addr_type = BLE_ADDR_TYPE_PUBLIC;
 static bool s_current_addr_valid = false;
 
+/* 控制器接受列表：绑定变化后标记，下一轮广播开始前同步（广播期间不能修改）。
+ * 过滤规则：快速档位只接受已绑定手机的连接，保证其回连不被陌生设备抢占；
+ * 绑定表还有空位时慢速 / 后台档位不过滤，新手机在这段时间连接并发送 BINDING_INFO；
+ * 表满后所有档位都过滤，新手机需等手机端或本地解绑腾出槽位 */
+static volatile bool s_accept_list_dirty = true;
+static bool s_accept_list_active = false;
+static bool s_accept_list_full = false;  /* 绑定表已满，慢速 / 后台档位也过滤 */
+
 
 /* ================== BLE 状态 ================== */
 static ble_state_t s_ble_state = BLE_STATE_UNINITIALIZED;
@@ -113,12 +380,18 @@ static uint16_t s_gatts_if = 0;
 static uint32_t s_error_count = 0;
 static uint8_t s_init_retry_count = 0;
 
+/* 连接建立阶段（服务发现 / MTU 交换 / 参数协商）持有 PM 锁，协商完成后释放，
+ * 之后由控制器 modem sleep 在连接事件间隙维持链路 */
+static bool s_conn_pm_locked = false;
+
 /* 全局连接状态标识 */
 bool ble_is_connected = false;
 
 static ble_message_callback_t s_message_callback = NULL;
+static ble_message_batch_callback_t s_message_batch_callback = NULL;
 static ble_time_sync_callback_t s_time_sync_callback = NULL;
 static ble_connection_callback_t s_connection_callback = NULL;
+static void (*s_pending_callback)(void) = NULL;
 
 
 /* ================== GATT 服务句柄 ================== */
@@ -144,16 +417,26 @@ enum {
 
 
 /* ================== 绑定相关函数声明 ================== */
-static void handle_binding_packet(const uint8_t* data, size_t length);
-static void save_binding_info(void);
+static void handle_binding_packet(const bipupu_packet_view_t* packet);
+static void save_binding_info(const char* info);
 static void clear_binding_info(void);
 static void load_binding_info(void);
 static bool check_binding_match(void);
+static void accept_list_sync(void);
+static void bond_on_connect(void);
+static void bond_on_disconnect(void);
+static void bond_table_save(void);
+static void bond_count_messages(int count);
 
 
 /* ================== 私有函数声明 ================== */
 static void handle_time_sync_directly(uint32_t timestamp);
 static void handle_received_packet(const uint8_t* data, size_t length);
+static void rx_reset(void);
+static bool rx_feed(const uint8_t* data, size_t length);
+static esp_err_t ble_worker_start(void);
+static void handle_prepare_write(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param);
+static void handle_exec_write(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param);
 static void generate_device_name(void);
 static void update_ble_state(ble_state_t new_state);
 static esp_err_t ble_stack_init(void);
@@ -161,8 +444,17 @@ static esp_err_t ble_stack_deinit(void);
 static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
 static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param);
 static void gatts_profile_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param);
-static esp_err_t nus_tx_notify(const uint8_t* data, size_t length);
+static esp_err_t nus_tx_notify(const uint8_t* data, size_t length, tx_prio_t prio);
+static void tx_pump(void);
+static void tx_reset(void);
 static void send_ack_response(uint32_t original_message_id);
+static void send_nack_response(uint32_t original_message_id, bipupu_nack_reason_t reason);
+static void send_credit_update(void);
+static uint8_t flow_credits(void);
+static void ack_message(uint32_t message_id);
+static void ack_flush(void);
+static void handle_hello(const bipupu_packet_view_t* packet);
+static bool enqueue_messages(const bipupu_batch_record_t* records, int count, uint32_t message_id);
 static esp_err_t start_advertising(void);
 
 
@@ -251,7 +543,10 @@ static void update_ble_state(ble_state_t new_state)
 static uint8_t s_adv_data[31] = {0};
 static uint8_t s_adv_data_len = 0;
 
-/* 广告参数配置 */
+/* 广告数据只在设备名变化后重新构建并下发控制器，控制器在停止 / 重启广播间保留数据 */
+static bool s_adv_data_dirty = true;
+
+/* 广告参数配置，间隔由当前广播档位填入 */
 static esp_ble_adv_params_t adv_params = {
     .adv_int_min        = 0x20,    // 20ms (单位 0.625ms)
     .adv_int_max        = 0x40,    // 40ms
@@ -305,14 +600,444 @@ static esp_err_t build_adv_data(void)
     return ESP_OK;
 }
 
+/* ================== 状态信标（扫描响应） ================== */
+
+/* 扫描响应只携带厂商数据：[len][0xFF][BIPUPU_BEACON_LENGTH 字节]。
+ * 内容变化时直接重新下发扫描响应，不需要停止广播 */
+static uint8_t s_beacon[BIPUPU_BEACON_LENGTH] = {0};
+static bool s_beacon_valid = false;
+static portMUX_TYPE s_beacon_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/* 本次连接是否收到过消息，用于统计信标本可避免的空连接 */
+static volatile bool s_conn_delivered = false;
+
+static void build_beacon(uint8_t* out)
+{
+    int unread = storage_msglog_unread_count();
+    uint16_t seq = (uint16_t)storage_msglog_seq();
+    // 电量按 5% 取整，避免 ADC 抖动导致频繁更新
+    uint8_t battery = (uint8_t)((board_battery_percent() + 2) / 5 * 5);
+
+    out[0] = BIPUPU_BEACON_COMPANY_ID & 0xFF;
+    out[1] = BIPUPU_BEACON_COMPANY_ID >> 8;
+    out[2] = BIPUPU_PROTOCOL_HEADER;
+    out[3] = BIPUPU_PROTOCOL_VERSION;
+    out[4] = unread > 0xFF ? 0xFF : (uint8_t)unread;
+    out[5] = battery;
+    out[6] = seq & 0xFF;
+    out[7] = seq >> 8;
+}
+
+/** 信标内容变化（或尚未下发）时重新配置扫描响应 */
+static esp_err_t beacon_refresh(void)
+{
+    uint8_t beacon[BIPUPU_BEACON_LENGTH];
+    build_beacon(beacon);
+
+    portENTER_CRITICAL(&s_beacon_mux);
+    bool changed = !s_beacon_valid || memcmp(beacon, s_beacon, sizeof(beacon)) != 0;
+    if (changed) {
+        memcpy(s_beacon, beacon, sizeof(beacon));
+        s_beacon_valid = true;
+    }
+    portEXIT_CRITICAL(&s_beacon_mux);
+
+    if (!changed) {
+        return ESP_OK;
+    }
+
+    uint8_t rsp[2 + BIPUPU_BEACON_LENGTH];
+    rsp[0] = BIPUPU_BEACON_LENGTH + 1;
+    rsp[1] = ESP_BLE_AD_MANUFACTURER_SPECIFIC_TYPE;
+    memcpy(&rsp[2], beacon, sizeof(beacon));
+
+    esp_err_t ret = esp_ble_gap_config_scan_rsp_data_raw(rsp, sizeof(rsp));
+    if (ret != ESP_OK) {
+        s_beacon_valid = false;
+        return ret;
+    }
+    s_stats.beacon_updates++;
+    ESP_LOGD(TAG, "状态信标: unread=%u battery=%u%% seq=%u",
+             beacon[4], beacon[5], beacon[6] | (beacon[7] << 8));
+    return ESP_OK;
+}
+
+/** 广告内容（设备名等）变化后调用，下次启动广播时重新构建并下发 */
+static void adv_data_invalidate(void)
+{
+    s_adv_data_dirty = true;
+    s_beacon_valid = false;
+}
+
+
+/* ================== 分级广播调度 ================== */
+
+typedef enum {
+    ADV_TIER_NONE,
+    ADV_TIER_FAST,         /**< 20-30ms，持续 ADV_FAST_DURATION_MS */
+    ADV_TIER_SLOW,         /**< ADV_INTERVAL_MIN_MS - ADV_INTERVAL_MAX_MS，持续 ADV_SLOW_DURATION_MS */
+    ADV_TIER_BACKGROUND,   /**< 长间隔，直到连接或停止 */
+    ADV_TIER_COUNT,
+} adv_tier_t;
+
+typedef struct {
+    uint16_t int_min;      /**< 单位 0.625ms */
+    uint16_t int_max;
+    uint32_t duration_ms;  /**< 0 表示不再降级 */
+} adv_tier_params_t;
+
+static const adv_tier_params_t s_adv_tiers[ADV_TIER_COUNT] = {
+    [ADV_TIER_FAST]       = { ADV_INTERVAL_UNITS(20), ADV_INTERVAL_UNITS(30), ADV_FAST_DURATION_MS },
+    [ADV_TIER_SLOW]       = { ADV_INTERVAL_UNITS(ADV_INTERVAL_MIN_MS), ADV_INTERVAL_UNITS(ADV_INTERVAL_MAX_MS),
+                              ADV_SLOW_DURATION_MS },
+    [ADV_TIER_BACKGROUND] = { ADV_INTERVAL_UNITS(ADV_BACKGROUND_MIN_MS), ADV_INTERVAL_UNITS(ADV_BACKGROUND_MAX_MS), 0 },
+};
+
+static const char* const s_adv_tier_names[ADV_TIER_COUNT] = { "none", "fast", "slow", "background" };
+
+/* 档位切换定时器在 esp_timer 任务中只发起停止，重启在 ADV_STOP_COMPLETE 事件中完成 */
+static esp_timer_handle_t s_adv_timer = NULL;
+static volatile bool s_adv_switching = false;
+
+/* 停止完成后重新开始一轮广播（接受列表变化时使用） */
+static volatile bool s_adv_restart = false;
+
+/* 当前档位与进入时间（ms），读取统计时需加锁 */
+static portMUX_TYPE s_adv_mux = portMUX_INITIALIZER_UNLOCKED;
+static adv_tier_t s_adv_tier = ADV_TIER_NONE;
+static uint32_t s_adv_tier_since_ms = 0;
+
+/* 本轮广播开始时间，用于统计回连耗时；0 表示不在广播中 */
+static int64_t s_adv_session_start_us = 0;
+
+static uint32_t* adv_tier_counter(ble_manager_stats_t* st, adv_tier_t tier)
+{
+    switch (tier) {
+        case ADV_TIER_FAST:       return &st->adv_fast_ms;
+        case ADV_TIER_SLOW:       return &st->adv_slow_ms;
+        case ADV_TIER_BACKGROUND: return &st->adv_background_ms;
+        default:                  return NULL;
+    }
+}
+
+/** 切换当前档位，累计上一档位的停留时间 */
+static void adv_tier_set(adv_tier_t tier)
+{
+    uint32_t now = (uint32_t)(esp_timer_get_time() / 1000);
+
+    portENTER_CRITICAL(&s_adv_mux);
+    uint32_t* counter = adv_tier_counter(&s_stats, s_adv_tier);
+    if (counter) {
+        *counter += now - s_adv_tier_since_ms;
+    }
+    s_adv_tier = tier;
+    s_adv_tier_since_ms = now;
+    portEXIT_CRITICAL(&s_adv_mux);
+}
+
+static void adv_timer_callback(void* arg)
+{
+    (void)arg;
+
+    if (s_ble_connected || s_adv_tier == ADV_TIER_NONE || s_adv_tier == ADV_TIER_BACKGROUND) {
+        return;
+    }
+
+    s_adv_switching = true;
+    if (esp_ble_gap_stop_advertising() != ESP_OK) {
+        s_adv_switching = false;
+    }
+}
+
+/**
+ * @brief 以指定档位开始广播
+ *
+ * 广告数据未变化时直接启动，否则先下发数据，在 ADV_DATA_RAW_SET_COMPLETE 事件中启动。
+ */
+static esp_err_t adv_start_tier(adv_tier_t tier)
+{
+    const adv_tier_params_t* t = &s_adv_tiers[tier];
+    adv_params.adv_int_min = t->int_min;
+    adv_params.adv_int_max = t->int_max;
+
+    // 不用定向广播：定向广播不可扫描，会让快速档位期间看不到状态信标，
+    // 且只能指向一台手机。改为可扫描的普通广播，由接受列表过滤连接请求
+    adv_params.adv_type = ADV_TYPE_IND;
+    bool filtered = s_accept_list_active && (tier == ADV_TIER_FAST || s_accept_list_full);
+    adv_params.adv_filter_policy = filtered ? ADV_FILTER_ALLOW_SCAN_ANY_CON_WLST
+                                            : ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY;
+
+    esp_err_t ret;
+    if (s_adv_data_dirty) {
+        build_adv_data();
+        // 实际广播将在 ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT 事件中启动
+        ret = esp_ble_gap_config_adv_data_raw(s_adv_data, s_adv_data_len);
+        if (ret == ESP_OK) {
+            beacon_refresh();
+            s_adv_data_dirty = false;
+            s_stats.adv_data_configs++;
+            ESP_LOGI(TAG, "正在配置广告数据...");
+        }
+    } else {
+        ret = esp_ble_gap_start_advertising(&adv_params);
+    }
+
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    adv_tier_set(tier);
+    if (t->duration_ms > 0 && s_adv_timer != NULL) {
+        esp_timer_stop(s_adv_timer);
+        esp_timer_start_once(s_adv_timer, (uint64_t)t->duration_ms * 1000);
+    }
+    ESP_LOGI(TAG, "广播档位: %s (%u-%ums)", s_adv_tier_names[tier],
+             (unsigned)(t->int_min * 625 / 1000), (unsigned)(t->int_max * 625 / 1000));
+    return ESP_OK;
+}
+
+/** 广播结束（连接建立或主动停止）时调用 */
+static void adv_session_end(bool connected)
+{
+    if (s_adv_timer != NULL) {
+        esp_timer_stop(s_adv_timer);
+    }
+    s_adv_switching = false;
+    adv_tier_t tier = s_adv_tier;
+    adv_tier_set(ADV_TIER_NONE);
+
+    if (connected && s_adv_session_start_us != 0) {
+        uint32_t ms = (uint32_t)((esp_timer_get_time() - s_adv_session_start_us) / 1000);
+        s_stats.reconnects++;
+        s_stats.reconnect_last_ms = ms;
+        if (ms > s_stats.reconnect_max_ms) {
+            s_stats.reconnect_max_ms = ms;
+        }
+        ESP_LOGI(TAG, "广播 %lums 后连接 (档位 %s)", (unsigned long)ms, s_adv_tier_names[tier]);
+    }
+    s_adv_session_start_us = 0;
+}
+
+static esp_err_t adv_scheduler_init(void)
+{
+    if (s_adv_timer != NULL) {
+        return ESP_OK;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = adv_timer_callback,
+        .arg = NULL,
+        .name = "ble_adv",
+        .dispatch_method = ESP_TIMER_TASK,
+    };
+    return esp_timer_create(&timer_args, &s_adv_timer);
+}
+
+
+/* ================== 连接阶段 PM 锁 ================== */
+
+static void conn_pm_lock(void)
+{
+    if (!s_conn_pm_locked) {
+        s_conn_pm_locked = true;
+        board_pm_acquire(BOARD_PM_LOCK_BLE);
+    }
+}
+
+static void conn_pm_unlock(void)
+{
+    if (s_conn_pm_locked) {
+        s_conn_pm_locked = false;
+        board_pm_release(BOARD_PM_LOCK_BLE);
+    }
+}
+
+
+/* ================== 回调耗时统计 ================== */
+
+static void callback_account(int64_t start_us)
+{
+    uint32_t us = (uint32_t)(esp_timer_get_time() - start_us);
+    s_stats.callbacks++;
+    s_stats.callback_total_us += us;
+    if (us > s_stats.callback_max_us) {
+        s_stats.callback_max_us = us;
+    }
+}
+
+
+/* ================== 链路优化 ================== */
+
+static void link_info_reset(void)
+{
+    s_link_tx_phy = ESP_BLE_GAP_PHY_1M;
+    s_link_rx_phy = ESP_BLE_GAP_PHY_1M;
+    s_link_tx_len = LINK_DATA_LEN_DEFAULT;
+    s_link_rx_len = LINK_DATA_LEN_DEFAULT;
+}
+
+/**
+ * @brief 首次连接参数更新结束后请求 2M PHY 与最大链路层数据长度
+ *
+ * 与连接参数更新错开，避免几个链路层过程在连接初期同时进行；更新被拒绝也照常请求。
+ * 两者都由对端决定是否接受，实际结果在 PHY_UPDATE / SET_PKT_LENGTH 事件中记录；
+ * 对端不支持时保持 1M PHY / 27 字节，不影响连接。
+ */
+static void link_optimize(esp_bd_addr_t bda)
+{
+    esp_err_t ret = esp_ble_gap_set_preferred_phy(bda, 0,
+                                                  ESP_BLE_GAP_PHY_2M_PREF_MASK,
+                                                  ESP_BLE_GAP_PHY_2M_PREF_MASK,
+                                                  ESP_BLE_GAP_PHY_OPTIONS_NO_PREF);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "请求2M PHY失败: %s", esp_err_to_name(ret));
+    }
+
+    ret = esp_ble_gap_set_pkt_data_len(bda, LINK_DATA_LEN_MAX);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "请求数据长度扩展失败: %s", esp_err_to_name(ret));
+    }
+}
+
+
+/* ================== 连接参数策略 ================== */
+
+static uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+/** 记录实际生效的连接模式，累计上一模式的停留时间 */
+static void conn_mode_set(conn_mode_t mode)
+{
+    uint32_t now = now_ms();
+
+    portENTER_CRITICAL(&s_conn_mux);
+    conn_mode_t old = s_conn_mode;
+    uint32_t spent = now - s_conn_mode_since_ms;
+    if (old == CONN_MODE_FAST) {
+        s_stats.conn_fast_ms += spent;
+    } else if (old == CONN_MODE_IDLE) {
+        s_stats.conn_idle_ms += spent;
+    }
+    s_conn_mode = mode;
+    s_conn_mode_since_ms = now;
+    portEXIT_CRITICAL(&s_conn_mux);
+
+    if (old != mode) {
+        ESP_LOGI(TAG, "连接模式 %s -> %s (累计 fast=%lus idle=%lus)",
+                 s_conn_mode_names[old], s_conn_mode_names[mode],
+                 (unsigned long)(s_stats.conn_fast_ms / 1000),
+                 (unsigned long)(s_stats.conn_idle_ms / 1000));
+    }
+}
+
+/** 在 ble_worker 中调用：记录一次收发流量 */
+static void conn_activity(void)
+{
+    s_conn_last_activity_us = esp_timer_get_time();
+}
+
+static void conn_request(conn_mode_t mode)
+{
+    const conn_mode_params_t* p = &s_conn_mode_params[mode];
+    esp_ble_conn_update_params_t params = {
+        .min_int = p->min_int,
+        .max_int = p->max_int,
+        .latency = p->latency,
+        .timeout = p->timeout,
+    };
+    memcpy(params.bda, s_current_remote_addr, sizeof(esp_bd_addr_t));
+
+    esp_err_t ret = esp_ble_gap_update_conn_params(&params);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "请求连接参数(%s)失败: %s", s_conn_mode_names[mode], esp_err_to_name(ret));
+        s_stats.conn_update_failures++;
+        s_conn_retry_us = esp_timer_get_time() + CONN_RETRY_MS * 1000LL;
+        return;
+    }
+
+    s_conn_requested = mode;
+    s_conn_update_pending = true;
+}
+
+/** 连接建立 / 断开时由 ble_worker 调用 */
+static void conn_policy_reset(void)
+{
+    s_conn_requested = CONN_MODE_NONE;
+    s_conn_update_pending = false;
+    s_conn_retry_us = 0;
+    conn_mode_set(CONN_MODE_NONE);
+
+    if (s_ble_connected) {
+        // 连接初期有服务发现、HELLO 与时间同步，先按传输中处理
+        conn_activity();
+        conn_request(CONN_MODE_FAST);
+    }
+}
+
+/** 处理 ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT 的结果（ble_worker） */
+static void conn_on_update(void)
+{
+    s_conn_update_pending = false;
+
+    if (s_conn_evt_status != ESP_BT_STATUS_SUCCESS) {
+        // 对端拒绝：按当前参数继续，稍后重试
+        s_stats.conn_update_failures++;
+        s_conn_requested = CONN_MODE_NONE;
+        s_conn_retry_us = esp_timer_get_time() + CONN_RETRY_MS * 1000LL;
+        return;
+    }
+
+    // 参数可能由手机发起或被调整，按实际间隔归类
+    s_stats.conn_updates++;
+    bool idle = s_conn_evt_latency > 0 ||
+                s_conn_evt_interval >= s_conn_mode_params[CONN_MODE_IDLE].min_int;
+    conn_mode_set(idle ? CONN_MODE_IDLE : CONN_MODE_FAST);
+}
+
+/**
+ * @brief 根据流量决定目标模式并在需要时请求更新（ble_worker）
+ *
+ * @return 下一次需要评估的等待时间（tick），无需定时评估时返回 portMAX_DELAY
+ */
+static TickType_t conn_policy_run(void)
+{
+    if (!s_ble_connected || s_conn_update_pending) {
+        return portMAX_DELAY;
+    }
+
+    int64_t now = esp_timer_get_time();
+    int64_t idle_at = s_conn_last_activity_us + CONN_IDLE_TIMEOUT_MS * 1000LL;
+    conn_mode_t want = now < idle_at ? CONN_MODE_FAST : CONN_MODE_IDLE;
+
+    if (want != s_conn_requested) {
+        if (now < s_conn_retry_us) {
+            return pdMS_TO_TICKS((s_conn_retry_us - now + 999) / 1000) + 1;
+        }
+        conn_request(want);
+        return portMAX_DELAY;
+    }
+
+    if (want == CONN_MODE_FAST) {
+        return pdMS_TO_TICKS((idle_at - now + 999) / 1000) + 1;
+    }
+    return portMAX_DELAY;
+}
+
 
 /* ================== GAP 事件处理 ================== */
 
 static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
 {
+    int64_t start_us = esp_timer_get_time();
+
     switch (event) {
         case ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT:
             ESP_LOGI(TAG, "广告数据设置完成，现在真正启动广播");
+            if (param->adv_data_raw_cmpl.status != ESP_BT_STATUS_SUCCESS) {
+                adv_data_invalidate();
+            }
             // 收到数据配置成功的事件后，再执行启动
             esp_ble_gap_start_advertising(&adv_params);
             break;
@@ -328,10 +1053,61 @@ static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param
             }
             break;
 
+        case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
+            ESP_LOGI(TAG, "连接参数更新: status=%d, interval=%d, latency=%d, timeout=%d",
+                     param->update_conn_params.status, param->update_conn_params.conn_int,
+                     param->update_conn_params.latency, param->update_conn_params.timeout);
+            // 连接参数协商结束，进入稳定连接状态，允许自动 Light Sleep
+            conn_pm_unlock();
+            if (s_link_optimize_pending && s_ble_connected) {
+                s_link_optimize_pending = false;
+                link_optimize(s_current_remote_addr);
+            }
+            s_conn_evt_status = param->update_conn_params.status;
+            s_conn_evt_interval = param->update_conn_params.conn_int;
+            s_conn_evt_latency = param->update_conn_params.latency;
+            if (s_cmd_queue != NULL) {
+                ble_cmd_t cmd = { .type = BLE_CMD_CONN_PARAMS };
+                xQueueSend(s_cmd_queue, &cmd, 0);
+            }
+            break;
+
+        case ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT:
+            if (param->phy_update.status == ESP_BT_STATUS_SUCCESS) {
+                s_link_tx_phy = param->phy_update.tx_phy;
+                s_link_rx_phy = param->phy_update.rx_phy;
+            }
+            ESP_LOGI(TAG, "PHY更新: status=%d, tx=%d, rx=%d", param->phy_update.status,
+                     param->phy_update.tx_phy, param->phy_update.rx_phy);
+            break;
+
+        case ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT:
+            if (param->pkt_data_length_cmpl.status == ESP_BT_STATUS_SUCCESS) {
+                s_link_tx_len = param->pkt_data_length_cmpl.params.tx_len;
+                s_link_rx_len = param->pkt_data_length_cmpl.params.rx_len;
+            }
+            ESP_LOGI(TAG, "数据长度更新: status=%d, tx=%d, rx=%d", param->pkt_data_length_cmpl.status,
+                     param->pkt_data_length_cmpl.params.tx_len, param->pkt_data_length_cmpl.params.rx_len);
+            break;
+
         case ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT:
+            if (s_adv_switching) {
+                // 档位到期：以下一档位重启，状态保持为广播中
+                s_adv_switching = false;
+                if (!s_ble_connected && s_adv_tier != ADV_TIER_NONE &&
+                    adv_start_tier((adv_tier_t)(s_adv_tier + 1)) == ESP_OK) {
+                    break;
+                }
+                adv_session_end(false);
+            }
             if (param->adv_stop_cmpl.status == ESP_BT_STATUS_SUCCESS) {
                 ESP_LOGI(TAG, "广告停止成功");
                 update_ble_state(BLE_STATE_IDLE);
+                if (s_adv_restart) {
+                    // 绑定变化：以新的接受列表重新开始一轮广播
+                    s_adv_restart = false;
+                    start_advertising();
+                }
             } else {
                 ESP_LOGE(TAG, "广告停止失败: %d", param->adv_stop_cmpl.status);
             }
@@ -340,6 +1116,8 @@ static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param
         default:
             break;
     }
+
+    callback_account(start_us);
 }
 
 
@@ -401,12 +1179,25 @@ static void gatts_profile_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_
         case ESP_GATTS_CONNECT_EVT: {
             s_conn_id = param->connect.conn_id;
             s_ble_connected = true;
+            conn_pm_lock();
             ble_is_connected = true;
             update_ble_state(BLE_STATE_CONNECTED);
 
             // 保存对端地址
             memcpy(s_current_remote_addr, param->connect.remote_bda, sizeof(esp_bd_addr_t));
+            s_current_addr_type = param->connect.ble_addr_type;
             s_current_addr_valid = true;
+            bond_on_connect();
+            if (s_is_bound && !check_binding_match()) {
+                s_stats.stranger_connections++;
+            }
+            adv_session_end(true);
+            s_conn_delivered = false;
+            s_stats.connections++;
+            s_notify_enabled = false;
+            s_tx_congested = false;
+            s_mtu = ATT_DEFAULT_MTU;
+            rx_reset();
             
             ESP_LOGI(TAG, "设备连接, conn_id=%d, addr=" ESP_BD_ADDR_STR, 
                     s_conn_id, ESP_BD_ADDR_HEX(s_current_remote_addr));
@@ -415,15 +1206,10 @@ static void gatts_profile_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_
                 s_connection_callback(true);
             }
 
-            // 更新连接参数
-            esp_ble_conn_update_params_t conn_params = {
-                .min_int = 0x10,    // 最小连接间隔
-                .max_int = 0x20,    // 最大连接间隔
-                .latency = 0,       // 延迟
-                .timeout = 400      // 超时
-            };
-            memcpy(conn_params.bda, param->connect.remote_bda, sizeof(esp_bd_addr_t));
-            esp_ble_gap_update_conn_params(&conn_params);
+            // 连接参数由 ble_worker 的策略管理（收到 LINK_RESET 后先请求短间隔），
+            // PHY / DLE 在该次更新结束后请求
+            link_info_reset();
+            s_link_optimize_pending = true;
             break;
         }
 
@@ -433,7 +1219,16 @@ static void gatts_profile_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_
             ble_is_connected = false;
             s_conn_id = 0xFFFF;
             s_current_addr_valid = false;
+            bond_on_disconnect();
             memset(s_current_remote_addr, 0, sizeof(s_current_remote_addr));
+            s_notify_enabled = false;
+            s_link_optimize_pending = false;
+            link_info_reset();
+            if (!s_conn_delivered) {
+                s_stats.idle_connections++;
+            }
+            rx_reset();
+            conn_pm_unlock();
             update_ble_state(BLE_STATE_IDLE);
 
             if (s_connection_callback) {
@@ -446,25 +1241,54 @@ static void gatts_profile_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_
         }
 
         case ESP_GATTS_WRITE_EVT: {
-            if (!param->write.is_prep) {
-                ESP_LOGI(TAG, "收到写入, handle=%d, len=%d", param->write.handle, param->write.len);
-                
-                // 检查是否是RX特征值
-                if (param->write.handle == s_rx_char_handle && param->write.len > 0) {
-                    handle_received_packet(param->write.value, param->write.len);
-                }
+            if (param->write.is_prep) {
+                handle_prepare_write(gatts_if, param);
+                break;
+            }
 
-                // 发送写入响应
-                if (param->write.need_rsp) {
-                    esp_ble_gatts_send_response(gatts_if, param->write.conn_id, 
-                                                param->write.trans_id, ESP_GATT_OK, NULL);
+            ESP_LOGD(TAG, "收到写入, handle=%d, len=%d", param->write.handle, param->write.len);
+
+            // 检查是否是RX特征值
+            esp_gatt_status_t status = ESP_GATT_OK;
+            if (param->write.handle == s_rx_char_handle && param->write.len > 0) {
+                if (!rx_feed(param->write.value, param->write.len)) {
+                    status = ESP_GATT_INSUF_RESOURCE;
+                }
+            } else if (param->write.handle == s_tx_ccc_handle && param->write.len == 2) {
+                s_notify_enabled = (param->write.value[0] & 0x01) != 0;
+                ESP_LOGI(TAG, "通知%s", s_notify_enabled ? "已启用" : "已关闭");
+                if (s_notify_enabled && s_cmd_queue != NULL) {
+                    // 手机开始监听通知：告知初始额度，并发出此前排队的数据
+                    ble_cmd_t cmd = { .type = BLE_CMD_SEND_CREDIT };
+                    xQueueSend(s_cmd_queue, &cmd, 0);
                 }
             }
+
+            // 发送写入响应
+            if (param->write.need_rsp) {
+                esp_ble_gatts_send_response(gatts_if, param->write.conn_id,
+                                            param->write.trans_id, status, NULL);
+            }
             break;
         }
 
+        case ESP_GATTS_EXEC_WRITE_EVT:
+            handle_exec_write(gatts_if, param);
+            break;
+
         case ESP_GATTS_MTU_EVT:
             ESP_LOGI(TAG, "MTU更新: %d", param->mtu.mtu);
+            s_mtu = param->mtu.mtu;
+            break;
+
+        case ESP_GATTS_CONGEST_EVT:
+            s_tx_congested = param->congest.congested;
+            if (s_tx_congested) {
+                s_stats.tx_congestions++;
+            } else if (s_cmd_queue != NULL) {
+                ble_cmd_t cmd = { .type = BLE_CMD_TX_KICK };
+                xQueueSend(s_cmd_queue, &cmd, 0);
+            }
             break;
 
         default:
@@ -491,7 +1315,9 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
     }
 
     // 处理profile事件
+    int64_t start_us = esp_timer_get_time();
     gatts_profile_event_handler(event, gatts_if, param);
+    callback_account(start_us);
 }
 
 
@@ -616,6 +1442,9 @@ static esp_err_t ble_stack_deinit(void)
     s_conn_id = 0xFFFF;
     s_service_handle = 0;
 
+    // 控制器复位后需重新下发广告数据
+    adv_data_invalidate();
+
     ESP_LOGI(TAG, "蓝牙协议栈反初始化完成");
     return ESP_OK;
 }
@@ -625,34 +1454,325 @@ static esp_err_t ble_stack_deinit(void)
 
 static esp_err_t start_advertising(void)
 {
-    if (s_ble_state == BLE_STATE_ADVERTISING) {
+    if (s_ble_state == BLE_STATE_ADVERTISING || s_adv_switching) {
         return ESP_OK;
     }
 
-    // 先构建广告数据
-    build_adv_data();
-    
-    // 触发 GAP 设置原始广告数据
-    // 实际广播将在 ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT 事件中启动
-    esp_err_t ret = esp_ble_gap_config_adv_data_raw(s_adv_data, s_adv_data_len);
+    // 每轮广播从快速档位开始；此时未在广播，可以修改接受列表
+    accept_list_sync();
+    esp_err_t ret = adv_start_tier(ADV_TIER_FAST);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "设置广告数据失败: %s", esp_err_to_name(ret));
+        ESP_LOGE(TAG, "启动广播失败: %s", esp_err_to_name(ret));
         update_ble_state(BLE_STATE_ERROR);
         return ret;
     }
-    
-    ESP_LOGI(TAG, "正在配置广告数据...");
+
+    if (s_adv_session_start_us == 0) {
+        s_adv_session_start_us = esp_timer_get_time();
+    }
     return ESP_OK;
 }
 
 
+/* ================== RX 写入组装 ================== */
+
+static void on_rx_frame(const uint8_t* frame, size_t length, void* ctx)
+{
+    (void)ctx;
+    handle_received_packet(frame, length);
+}
+
+/**
+ * @brief 把一次写入拷贝到缓冲池并投递给工作任务（蓝牙回调上下文，不阻塞）
+ * @return false 缓冲池耗尽或写入过长，数据已丢弃
+ */
+static bool rx_feed(const uint8_t* data, size_t length)
+{
+    uint8_t block;
+
+    if (length > RX_BLOCK_SIZE || s_rx_free_queue == NULL ||
+        xQueueReceive(s_rx_free_queue, &block, 0) != pdTRUE) {
+        s_stats.rx_dropped++;
+        s_error_count++;
+        ESP_LOGW(TAG, "RX 缓冲池耗尽，丢弃 %u 字节", (unsigned)length);
+        return false;
+    }
+
+    memcpy(s_rx_pool[block], data, length);
+    ble_cmd_t cmd = { .type = BLE_CMD_RX_DATA, .block = block, .len = (uint16_t)length };
+    if (xQueueSend(s_cmd_queue, &cmd, 0) != pdTRUE) {
+        xQueueSend(s_rx_free_queue, &block, 0);
+        s_stats.rx_dropped++;
+        s_error_count++;
+        return false;
+    }
+
+    s_stats.rx_writes++;
+    uint32_t depth = (uint32_t)uxQueueMessagesWaiting(s_cmd_queue);
+    if (depth > s_stats.queue_high_water) {
+        s_stats.queue_high_water = depth;
+    }
+    return true;
+}
+
+static void rx_reset(void)
+{
+    s_prep_len = 0;
+    s_prep_status = ESP_GATT_OK;
+
+    if (s_cmd_queue != NULL) {
+        ble_cmd_t cmd = { .type = BLE_CMD_LINK_RESET };
+        if (xQueueSend(s_cmd_queue, &cmd, 0) != pdTRUE) {
+            ESP_LOGW(TAG, "命令队列已满，RX 复位未投递");
+        }
+    }
+}
+
+/**
+ * @brief 缓存长写入的一个分片
+ *
+ * 分片按 offset 顺序拼接到 s_prep_buf，执行写入时整体送入组装器。
+ * 出错的长写入在执行时整体丢弃，并把错误码报告给对端。
+ */
+static void handle_prepare_write(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param)
+{
+    esp_gatt_status_t status = ESP_GATT_OK;
+
+    if (param->write.handle != s_rx_char_handle) {
+        status = ESP_GATT_WRITE_NOT_PERMIT;
+    } else if (param->write.offset != s_prep_len) {
+        status = ESP_GATT_INVALID_OFFSET;
+    } else if ((size_t)param->write.offset + param->write.len > sizeof(s_prep_buf)) {
+        status = ESP_GATT_INVALID_ATTR_LEN;
+    }
+
+    if (status == ESP_GATT_OK) {
+        memcpy(&s_prep_buf[s_prep_len], param->write.value, param->write.len);
+        s_prep_len += param->write.len;
+    } else {
+        ESP_LOGW(TAG, "长写入分片被拒绝: offset=%d, len=%d, status=0x%02x",
+                 param->write.offset, param->write.len, status);
+        s_prep_status = status;
+    }
+
+    if (param->write.need_rsp) {
+        memset(&s_prep_rsp, 0, sizeof(s_prep_rsp));
+        s_prep_rsp.attr_value.handle = param->write.handle;
+        s_prep_rsp.attr_value.offset = param->write.offset;
+        s_prep_rsp.attr_value.auth_req = ESP_GATT_AUTH_REQ_NONE;
+        if (status == ESP_GATT_OK) {
+            s_prep_rsp.attr_value.len = param->write.len;
+            memcpy(s_prep_rsp.attr_value.value, param->write.value, param->write.len);
+        }
+        esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id,
+                                    status, &s_prep_rsp);
+    }
+}
+
+static void handle_exec_write(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param)
+{
+    esp_gatt_status_t status = s_prep_status;
+
+    if (param->exec_write.exec_write_flag == ESP_GATT_PREP_WRITE_EXEC &&
+        status == ESP_GATT_OK && s_prep_len > 0) {
+        ESP_LOGD(TAG, "执行长写入, len=%d", s_prep_len);
+        if (!rx_feed(s_prep_buf, s_prep_len)) {
+            status = ESP_GATT_INSUF_RESOURCE;
+        }
+    }
+
+    s_prep_len = 0;
+    s_prep_status = ESP_GATT_OK;
+
+    esp_ble_gatts_send_response(gatts_if, param->exec_write.conn_id,
+                                param->exec_write.trans_id, status, NULL);
+}
+
+
+/* ================== BLE 工作任务 ================== */
+
+static void ble_worker_task(void* arg)
+{
+    (void)arg;
+    ble_cmd_t cmd;
+
+    for (;;) {
+        // 有待确认的消息时最多等到合并窗口结束；发送失败时定时重试
+        TickType_t wait = portMAX_DELAY;
+        if (s_ack_count > 0) {
+            int64_t left_us = ACK_COALESCE_US - (esp_timer_get_time() - s_ack_first_us);
+            wait = left_us > 0 ? pdMS_TO_TICKS((left_us + 999) / 1000) + 1 : 0;
+        }
+        if (s_tx_retry && wait > pdMS_TO_TICKS(TX_RETRY_MS) + 1) {
+            wait = pdMS_TO_TICKS(TX_RETRY_MS) + 1;
+        }
+        TickType_t conn_wait = conn_policy_run();
+        if (conn_wait < wait) {
+            wait = conn_wait;
+        }
+
+        if (xQueueReceive(s_cmd_queue, &cmd, wait) != pdTRUE) {
+            if (s_ack_count > 0 && esp_timer_get_time() - s_ack_first_us >= ACK_COALESCE_US) {
+                ack_flush();
+            }
+            tx_pump();
+            continue;
+        }
+
+        int64_t start_us = esp_timer_get_time();
+
+        switch (cmd.type) {
+            case BLE_CMD_RX_DATA:
+                conn_activity();
+                bipupu_assembler_feed(&s_rx_assembler, s_rx_pool[cmd.block], cmd.len,
+                                      on_rx_frame, NULL);
+                xQueueSend(s_rx_free_queue, &cmd.block, 0);
+                break;
+
+            case BLE_CMD_LINK_RESET:
+                bipupu_assembler_reset(&s_rx_assembler);
+                s_ack_count = 0;
+                s_peer_features = 0;
+                tx_reset();
+                conn_policy_reset();
+                // 只做持久化；匹配结果已在断开事件中清除，这里不能再改（可能已快速回连）
+                if (!s_ble_connected && s_bonds_dirty) {
+                    bond_table_save();
+                }
+                break;
+
+            case BLE_CMD_SEND_CREDIT:
+                send_credit_update();
+                break;
+
+            case BLE_CMD_TX_KICK:
+                break;
+
+            case BLE_CMD_CONN_PARAMS:
+                conn_on_update();
+                break;
+
+            default:
+                break;
+        }
+
+        if (s_ack_count > 0 && esp_timer_get_time() - s_ack_first_us >= ACK_COALESCE_US) {
+            ack_flush();
+        }
+        tx_pump();
+
+        uint32_t us = (uint32_t)(esp_timer_get_time() - start_us);
+        if (us > s_stats.worker_max_us) {
+            s_stats.worker_max_us = us;
+        }
+    }
+}
+
+static esp_err_t ble_worker_start(void)
+{
+    if (s_worker_handle != NULL) {
+        return ESP_OK;
+    }
+
+    s_rx_free_queue = xQueueCreate(RX_POOL_BLOCKS, sizeof(uint8_t));
+    s_cmd_queue = xQueueCreate(BLE_CMD_QUEUE_DEPTH, sizeof(ble_cmd_t));
+    s_tx_ctrl_ring = xRingbufferCreate(TX_CTRL_RING_SIZE, RINGBUF_TYPE_NOSPLIT);
+    s_tx_bulk_ring = xRingbufferCreate(TX_BULK_RING_SIZE, RINGBUF_TYPE_NOSPLIT);
+    if (s_rx_free_queue == NULL || s_cmd_queue == NULL ||
+        s_tx_ctrl_ring == NULL || s_tx_bulk_ring == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (uint8_t i = 0; i < RX_POOL_BLOCKS; i++) {
+        xQueueSend(s_rx_free_queue, &i, 0);
+    }
+
+    BaseType_t ret = xTaskCreatePinnedToCore(ble_worker_task, "ble_worker",
+                                             BLE_TASK_STACK_SIZE, NULL, BLE_TASK_PRIORITY,
+                                             &s_worker_handle, BOARD_APP_CPU);
+    if (ret != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+
+/* ================== 重复消息抑制 ================== */
+
+/** 当前连接使用的序号窗口（ble_worker） */
+static seq_window_t* seq_window_current(void)
+{
+    int bond = s_conn_bond;
+    if (bond >= 0) {
+        return &s_seq_windows[bond];
+    }
+
+    // 未绑定的连接共用一个窗口，换了手机就清空，避免不同手机的序号互相冲突
+    seq_window_t* guest = &s_seq_windows[BLE_MAX_BONDS];
+    if (memcmp(s_seq_guest_addr, s_current_remote_addr, sizeof(esp_bd_addr_t)) != 0) {
+        memcpy(s_seq_guest_addr, s_current_remote_addr, sizeof(esp_bd_addr_t));
+        memset(guest, 0, sizeof(*guest));
+    }
+    return guest;
+}
+
+static bool seq_window_seen(const seq_window_t* w, uint32_t seq)
+{
+    if (!w->valid) {
+        return false;
+    }
+    int32_t d = (int32_t)(seq - w->top);
+    if (d > 0 || d <= -SEQ_WINDOW_BITS) {
+        return false;
+    }
+    return (w->bits >> (seq % SEQ_WINDOW_BITS)) & 1;
+}
+
+static void seq_window_mark(seq_window_t* w, uint32_t seq)
+{
+    int32_t d = (int32_t)(seq - w->top);
+    if (!w->valid || d <= -SEQ_WINDOW_BITS || d >= SEQ_WINDOW_BITS) {
+        w->bits = 0;
+        w->top = seq;
+        w->valid = true;
+    } else if (d > 0) {
+        // 窗口前移：清掉 (top, seq) 之间被跳过的序号
+        for (uint32_t s = w->top + 1; s != seq; s++) {
+            w->bits &= ~(1ULL << (s % SEQ_WINDOW_BITS));
+        }
+        w->top = seq;
+    }
+    w->bits |= 1ULL << (seq % SEQ_WINDOW_BITS);
+}
+
+/**
+ * @brief 带序号的帧是否为已收下消息的重传
+ *
+ * 重传说明手机没有收到上次的确认：再确认一次，但不重复入队、存储和提醒。
+ */
+static bool seq_is_duplicate(const bipupu_packet_view_t* packet)
+{
+    if (!packet->has_seq || !seq_window_seen(seq_window_current(), packet->seq)) {
+        return false;
+    }
+
+    s_stats.duplicates++;
+    ESP_LOGI(TAG, "重复消息 seq=%lu，只确认", (unsigned long)packet->seq);
+    ack_message(packet->seq);
+    return true;
+}
+
+
 /* ================== 数据包处理 ================== */
 
 static void handle_received_packet(const uint8_t* data, size_t length)
 {
-    bipupu_parsed_packet_t packet;
+    /* 视图直接指向组装器的帧缓冲，只拷贝需要入队的字段，避免在蓝牙任务栈上
+     * 展开约 800 字节的 bipupu_parsed_packet_t */
+    bipupu_packet_view_t packet;
 
-    if (!bipupu_protocol_parse(data, length, &packet)) {
+    if (!bipupu_protocol_parse_view(data, length, &packet)) {
         ESP_LOGW(TAG, "解析失败");
         s_error_count++;
         return;
@@ -670,6 +1790,9 @@ static void handle_received_packet(const uint8_t* data, size_t length)
         }
     }
 
+    // 带序号的帧以序号作为消息 ID，否则沿用帧头时间戳
+    uint32_t message_id = packet.has_seq ? packet.seq : packet.timestamp;
+
     switch (packet.message_type) {
         case BIPUPU_MSG_TIME_SYNC:
             handle_time_sync_directly(packet.timestamp);
@@ -678,30 +1801,47 @@ static void handle_received_packet(const uint8_t* data, size_t length)
             }
             break;
 
-        case BIPUPU_MSG_TEXT:
-            if (s_msg_queue != NULL) {
-                ble_msg_event_t evt;
-                strncpy(evt.sender, packet.sender_name, sizeof(evt.sender) - 1);
-                evt.sender[sizeof(evt.sender) - 1] = '\0';
-                strncpy(evt.body, packet.body_text, sizeof(evt.body) - 1);
-                evt.body[sizeof(evt.body) - 1] = '\0';
-                evt.timestamp = packet.timestamp;
-
-                if (xQueueSend(s_msg_queue, &evt, 0) != pdTRUE) {
-                    ESP_LOGW(TAG, "队列已满丢弃 [%s]", packet.sender_name);
-                } else {
-                    // 消息成功入队，发送 ACK 确认
-                    send_ack_response(packet.timestamp);
-                }
+        case BIPUPU_MSG_TEXT: {
+            if (seq_is_duplicate(&packet)) {
+                break;
+            }
+            bipupu_batch_record_t record = {
+                .timestamp = packet.timestamp,
+                .sender = packet.sender,
+                .body = packet.body,
+            };
+            if (enqueue_messages(&record, 1, message_id) && packet.has_seq) {
+                seq_window_mark(seq_window_current(), packet.seq);
             }
             break;
+        }
+
+        case BIPUPU_MSG_BATCH: {
+            if (seq_is_duplicate(&packet)) {
+                break;
+            }
+            bipupu_batch_record_t records[BIPUPU_BATCH_MAX_RECORDS];
+            int count = bipupu_protocol_parse_batch(&packet, records);
+            if (count < 0) {
+                s_error_count++;
+                break;
+            }
+            if (enqueue_messages(records, count, message_id) && packet.has_seq) {
+                seq_window_mark(seq_window_current(), packet.seq);
+            }
+            break;
+        }
 
         case BIPUPU_MSG_ACKNOWLEDGEMENT:
             break;
 
+        case BIPUPU_MSG_HELLO:
+            handle_hello(&packet);
+            break;
+
         case BIPUPU_MSG_BINDING_INFO:
         case BIPUPU_MSG_UNBIND_COMMAND:
-            handle_binding_packet(data, length);
+            handle_binding_packet(&packet);
             break;
 
         default:
@@ -711,64 +1851,338 @@ static void handle_received_packet(const uint8_t* data, size_t length)
 }
 
 
+/**
+ * @brief 把一帧中的消息作为一个环形缓冲区项入队
+ *
+ * 整帧占一个额度，只确认一次（message_id 为序号或帧头时间戳）；缓冲区不足时整帧回复 NACK。
+ *
+ * @return true 已入队并确认
+ */
+static bool enqueue_messages(const bipupu_batch_record_t* records, int count, uint32_t message_id)
+{
+    if (s_msg_ring == NULL || count <= 0) {
+        return false;
+    }
+
+    // 按原始长度预留空间：UTF-8 清洗不会让内容变长
+    size_t item_size = 0;
+    for (int i = 0; i < count; i++) {
+        bool same = i > 0 && records[i].sender.ptr == records[i - 1].sender.ptr;
+        size_t sender_max = same ? 0 : MIN(records[i].sender.len, MSG_SENDER_MAX);
+        size_t body_max = MIN(records[i].body.len, BIPUPU_MAX_DATA_LENGTH);
+        item_size += MSG_RECORD_SIZE(sender_max, body_max);
+    }
+
+    uint8_t* item = NULL;
+    if (xRingbufferSendAcquire(s_msg_ring, (void**)&item, item_size, 0) != pdTRUE) {
+        // 手机未遵守额度或 app_task 消费过慢：明确拒绝，手机暂停并在 CREDIT 后重发
+        s_stats.msg_dropped += count;
+        ESP_LOGW(TAG, "消息缓冲区已满拒绝 %d 条 [%.*s]", count,
+                 (int)records[0].sender.len, (const char*)records[0].sender.ptr);
+        send_nack_response(message_id, BIPUPU_NACK_BUSY);
+        return false;
+    }
+
+    uint8_t* p = item;
+    for (int i = 0; i < count; i++) {
+        ble_msg_record_t* rec = (ble_msg_record_t*)p;
+        bool same = i > 0 && records[i].sender.ptr == records[i - 1].sender.ptr;
+        size_t sender_max = same ? 0 : MIN(records[i].sender.len, MSG_SENDER_MAX);
+        size_t body_max = MIN(records[i].body.len, BIPUPU_MAX_DATA_LENGTH);
+
+        rec->timestamp = records[i].timestamp;
+        rec->flags = same ? MSG_REC_FLAG_SAME_SENDER : 0;
+        rec->sender_len = (uint8_t)bipupu_protocol_copy_utf8(
+            records[i].sender.ptr, sender_max, rec->text, sender_max + 1);
+        rec->body_len = (uint8_t)bipupu_protocol_copy_utf8(
+            records[i].body.ptr, body_max, rec->text + rec->sender_len + 1, body_max + 1);
+        p += MSG_RECORD_SIZE(sender_max, body_max);
+    }
+
+    portENTER_CRITICAL(&s_msg_mux);
+    s_msg_inflight++;
+    portEXIT_CRITICAL(&s_msg_mux);
+    xRingbufferSendComplete(s_msg_ring, item);
+
+    // 入队成功，确认（可能合并）并唤醒 app_task
+    s_conn_delivered = true;
+    bond_count_messages(count);
+    ack_message(message_id);
+    if (s_pending_callback) {
+        s_pending_callback();
+    }
+    return true;
+}
+
+
 /* ================== 响应发送 ================== */
 
-static esp_err_t nus_tx_notify(const uint8_t* data, size_t length)
+/**
+ * @brief 将一帧放入 TX 队列
+ *
+ * 可在任意任务中调用；ble_worker 之外的调用方通过 BLE_CMD_TX_KICK 唤醒发送。
+ * 队列满时丢弃本帧并计数（控制帧队列只在对端长时间不订阅 / 持续拥塞时才会满）。
+ */
+static esp_err_t nus_tx_notify(const uint8_t* data, size_t length, tx_prio_t prio)
 {
     if (!s_ble_connected || s_conn_id == 0xFFFF) {
         return ESP_ERR_INVALID_STATE;
     }
 
-    if (!data || length == 0 || length > 512) {
+    if (!data || length == 0 || length > BIPUPU_MAX_PACKET_LENGTH) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    // 发送通知
-    esp_err_t ret = esp_ble_gatts_send_indicate(s_gatts_if, s_conn_id, s_tx_char_handle, 
-                                                 length, (uint8_t *)data, false);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "发送通知失败: %s", esp_err_to_name(ret));
-        return ESP_FAIL;
+    RingbufHandle_t ring = (prio == TX_PRIO_CTRL) ? s_tx_ctrl_ring : s_tx_bulk_ring;
+    if (ring == NULL || xRingbufferSend(ring, data, length, 0) != pdTRUE) {
+        s_stats.tx_dropped++;
+        ESP_LOGW(TAG, "TX 队列已满，丢弃 %u 字节", (unsigned)length);
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xTaskGetCurrentTaskHandle() != s_worker_handle && s_cmd_queue != NULL) {
+        ble_cmd_t cmd = { .type = BLE_CMD_TX_KICK };
+        xQueueSend(s_cmd_queue, &cmd, 0);
     }
 
     return ESP_OK;
 }
 
+/**
+ * @brief 在 ble_worker 中发送排队的帧
+ *
+ * 控制帧优先，但只在帧边界处抢占，分片不会交错；超过 MTU - 3 的帧按 MTU 分片。
+ * 对端未订阅通知或链路拥塞时暂停，协议栈拒绝时保留当前分片并定时重试。
+ */
+static void tx_pump(void)
+{
+    s_tx_retry = false;
+
+    while (s_ble_connected && s_notify_enabled && !s_tx_congested) {
+        if (s_tx_cur == NULL) {
+            size_t size = 0;
+            s_tx_cur_ring = s_tx_ctrl_ring;
+            s_tx_cur = xRingbufferReceive(s_tx_ctrl_ring, &size, 0);
+            if (s_tx_cur == NULL) {
+                s_tx_cur_ring = s_tx_bulk_ring;
+                s_tx_cur = xRingbufferReceive(s_tx_bulk_ring, &size, 0);
+            }
+            if (s_tx_cur == NULL) {
+                return;
+            }
+            s_tx_cur_len = size;
+            s_tx_cur_off = 0;
+        }
+
+        size_t chunk = MIN(s_tx_cur_len - s_tx_cur_off, (size_t)(s_mtu - 3));
+        esp_err_t ret = esp_ble_gatts_send_indicate(s_gatts_if, s_conn_id, s_tx_char_handle,
+                                                    chunk, s_tx_cur + s_tx_cur_off, false);
+        if (ret != ESP_OK) {
+            ESP_LOGD(TAG, "发送通知暂不可用: %s", esp_err_to_name(ret));
+            s_tx_retry = true;
+            return;
+        }
+
+        s_tx_cur_off += chunk;
+        s_stats.tx_notifies++;
+        conn_activity();
+        if (s_tx_cur_off >= s_tx_cur_len) {
+            vRingbufferReturnItem(s_tx_cur_ring, s_tx_cur);
+            s_tx_cur = NULL;
+            s_stats.tx_frames++;
+        }
+    }
+}
+
+/** 连接变化时丢弃未发出的帧 */
+static void tx_reset(void)
+{
+    if (s_tx_cur != NULL) {
+        vRingbufferReturnItem(s_tx_cur_ring, s_tx_cur);
+        s_tx_cur = NULL;
+    }
+
+    RingbufHandle_t rings[] = { s_tx_ctrl_ring, s_tx_bulk_ring };
+    for (size_t i = 0; i < sizeof(rings) / sizeof(rings[0]); i++) {
+        size_t size;
+        void* item;
+        while (rings[i] != NULL && (item = xRingbufferReceive(rings[i], &size, 0)) != NULL) {
+            vRingbufferReturnItem(rings[i], item);
+        }
+    }
+    s_tx_retry = false;
+}
+
+
+/* ================== 流控 ================== */
+
+/** 当前还能保证接收的 TEXT 消息条数 */
+static uint8_t flow_credits(void)
+{
+    portENTER_CRITICAL(&s_msg_mux);
+    uint32_t inflight = s_msg_inflight;
+    portEXIT_CRITICAL(&s_msg_mux);
+
+    return inflight >= MSG_CREDITS_MAX ? 0 : (uint8_t)(MSG_CREDITS_MAX - inflight);
+}
+
+/**
+ * @brief 取得要通告给手机的额度
+ *
+ * 先置暂停标志再读取额度：若此时 app_task 恰好消费完毕，要么这里读到的额度已大于 0，
+ * 要么 app_task 看到暂停标志并补发 CREDIT，不会出现双方都在等待的情况。
+ */
+static uint8_t flow_advertise(void)
+{
+    s_flow_paused = true;
+    uint8_t credits = flow_credits();
+    if (credits > 0) {
+        s_flow_paused = false;
+    }
+    return credits;
+}
+
 static void send_ack_response(uint32_t original_message_id)
 {
     if (!s_ble_connected || s_conn_id == 0xFFFF) {
         return;
     }
 
+    ack_flush();
+
     uint8_t buffer[64];
-    size_t packet_length = bipupu_protocol_create_acknowledgement(
-        original_message_id, buffer, sizeof(buffer));
+    uint8_t credits = flow_advertise();
+    size_t packet_length = bipupu_protocol_create_ack_with_credits(
+        original_message_id, credits, buffer, sizeof(buffer));
+
+    if (packet_length > 0 && nus_tx_notify(buffer, packet_length, TX_PRIO_CTRL) == ESP_OK) {
+        s_stats.ack_frames++;
+        s_stats.acked_messages++;
+        ESP_LOGI(TAG, "已发送 ACK: msg_id=%u, 额度=%u", original_message_id, credits);
+    }
+}
 
+/**
+ * @brief 确认一条已入队的消息
+ *
+ * 未协商合并 ACK 的手机立即收到逐条 ACK；否则先记下消息 ID，在合并窗口结束、
+ * 攒满一帧或额度耗尽时（手机需要尽快知道）由 ack_flush() 一次发出。
+ */
+static void ack_message(uint32_t message_id)
+{
+    if (!(s_peer_features & BIPUPU_FEATURE_BATCH_ACK)) {
+        send_ack_response(message_id);
+        return;
+    }
+
+    if (s_ack_count == 0) {
+        s_ack_first_us = esp_timer_get_time();
+    }
+    s_ack_ids[s_ack_count++] = message_id;
+
+    if (s_ack_count >= BIPUPU_BATCH_ACK_MAX || flow_credits() == 0) {
+        ack_flush();
+    }
+}
+
+static void ack_flush(void)
+{
+    if (s_ack_count == 0) {
+        return;
+    }
+
+    uint8_t count = s_ack_count;
+    s_ack_count = 0;
+
+    if (!s_ble_connected || s_conn_id == 0xFFFF) {
+        return;
+    }
+
+    uint8_t buffer[BIPUPU_HEADER_LENGTH + 2 + 4 * BIPUPU_BATCH_ACK_MAX + BIPUPU_CHECKSUM_LENGTH];
+    uint8_t credits = flow_advertise();
+    size_t packet_length = bipupu_protocol_create_batch_ack(s_ack_ids, count, credits,
+                                                            buffer, sizeof(buffer));
+
+    if (packet_length > 0 && nus_tx_notify(buffer, packet_length, TX_PRIO_CTRL) == ESP_OK) {
+        s_stats.ack_frames++;
+        s_stats.acked_messages += count;
+        ESP_LOGI(TAG, "已发送合并 ACK: %u 条, 额度=%u", count, credits);
+    }
+}
+
+static void handle_hello(const bipupu_packet_view_t* packet)
+{
+    uint8_t peer_version = packet->payload.len > 0 ? packet->payload.ptr[0] : 0;
+    uint8_t peer_features = packet->payload.len > 1 ? packet->payload.ptr[1] : 0;
+
+    ack_flush();
+    s_peer_features = peer_features & DEVICE_FEATURES;
+    ESP_LOGI(TAG, "HELLO: 对端版本 0x%02X, 特性 0x%02X -> 0x%02X",
+             peer_version, peer_features, s_peer_features);
+
+    if (!s_ble_connected || s_conn_id == 0xFFFF) {
+        return;
+    }
+
+    uint8_t buffer[16];
+    size_t packet_length = bipupu_protocol_create_hello(
+        BIPUPU_PROTOCOL_VERSION, s_peer_features, flow_advertise(), buffer, sizeof(buffer));
     if (packet_length > 0) {
-        nus_tx_notify(buffer, packet_length);
-        ESP_LOGI(TAG, "已发送 ACK: msg_id=%u", original_message_id);
+        nus_tx_notify(buffer, packet_length, TX_PRIO_CTRL);
     }
 }
 
+static void send_nack_response(uint32_t original_message_id, bipupu_nack_reason_t reason)
+{
+    if (!s_ble_connected || s_conn_id == 0xFFFF) {
+        return;
+    }
 
-/* ================== 绑定管理 ================== */
+    // 保持确认顺序：先发出之前已入队消息的 ACK
+    ack_flush();
+
+    uint8_t buffer[64];
+    uint8_t credits = flow_advertise();
+    size_t packet_length = bipupu_protocol_create_nack(
+        original_message_id, reason, credits, buffer, sizeof(buffer));
+
+    if (packet_length > 0 && nus_tx_notify(buffer, packet_length, TX_PRIO_CTRL) == ESP_OK) {
+        s_stats.nacks_sent++;
+        ESP_LOGW(TAG, "已发送 NACK: msg_id=%u, 原因=%u, 额度=%u",
+                 original_message_id, reason, credits);
+    }
+}
 
-static void handle_binding_packet(const uint8_t* data, size_t length)
+static void send_credit_update(void)
 {
-    bipupu_parsed_packet_t parsed;
-    if (!bipupu_protocol_parse(data, length, &parsed)) {
-        ESP_LOGW(TAG, "解析绑定数据失败");
+    if (!s_ble_connected || s_conn_id == 0xFFFF) {
         return;
     }
 
-    switch (parsed.message_type) {
+    uint8_t buffer[16];
+    uint8_t credits = flow_advertise();
+    size_t packet_length = bipupu_protocol_create_credit(credits, buffer, sizeof(buffer));
+
+    if (packet_length > 0 && nus_tx_notify(buffer, packet_length, TX_PRIO_CTRL) == ESP_OK) {
+        s_stats.credit_updates++;
+        ESP_LOGI(TAG, "已发送额度更新: %u", credits);
+    }
+}
+
+
+/* ================== 绑定管理 ================== */
+
+static void handle_binding_packet(const bipupu_packet_view_t* packet)
+{
+    switch (packet->message_type) {
         case BIPUPU_MSG_BINDING_INFO: {
             char json_str[256];
-            bipupu_protocol_decode_utf8_safe(parsed.data, parsed.data_length, json_str);
+            bipupu_protocol_copy_utf8(packet->payload.ptr, packet->payload.len,
+                                      json_str, sizeof(json_str));
             ESP_LOGI(TAG, "绑定 %s", json_str);
-            save_binding_info();
+            save_binding_info(json_str);
             // 发送 ACK 确认绑定成功
-            send_ack_response(parsed.timestamp);
+            send_ack_response(packet->timestamp);
             break;
         }
 
@@ -776,8 +2190,9 @@ static void handle_binding_packet(const uint8_t* data, size_t length)
             ESP_LOGI(TAG, "解绑");
             clear_binding_info();
             // 发送解绑确认响应
-            send_ack_response(parsed.timestamp);
-            // 延迟断开连接，确保响应发送完成
+            send_ack_response(packet->timestamp);
+            // 先把确认交给协议栈，再延迟断开连接，确保响应发送完成（在工作任务中等待，不阻塞蓝牙回调）
+            tx_pump();
             vTaskDelay(pdMS_TO_TICKS(50));
             if (s_ble_connected && s_conn_id != 0xFFFF) {
                 esp_ble_gatts_close(s_gatts_if, s_conn_id);
@@ -789,19 +2204,49 @@ static void handle_binding_packet(const uint8_t* data, size_t length)
     }
 }
 
-static void save_binding_info(void)
+/* ---------- 绑定表 ---------- */
+
+static int bond_count_locked(void)
 {
-    if (!s_ble_connected || s_conn_id == 0xFFFF || !s_current_addr_valid) {
-        ESP_LOGW(TAG, "无法保存绑定信息: 未连接或无有效地址");
-        return;
+    int n = 0;
+    for (int i = 0; i < BLE_MAX_BONDS; i++) {
+        n += s_bonds[i].used;
     }
-    
-    // 转换地址为字符串格式
-    char addr_str[18];
-    snprintf(addr_str, sizeof(addr_str), "%02x:%02x:%02x:%02x:%02x:%02x",
-             s_current_remote_addr[0], s_current_remote_addr[1], s_current_remote_addr[2],
-             s_current_remote_addr[3], s_current_remote_addr[4], s_current_remote_addr[5]);
-    
+    return n;
+}
+
+/**
+ * @brief 按原始地址查找绑定（持锁调用）
+ *
+ * 遍历全部表项且不提前退出，比较结果按位累积，耗时与匹配位置无关。
+ */
+static int bond_find_locked(const esp_bd_addr_t addr)
+{
+    int found = -1;
+    for (int i = 0; i < BLE_MAX_BONDS; i++) {
+        uint8_t diff = s_bonds[i].used ^ 1;
+        for (int j = 0; j < (int)sizeof(esp_bd_addr_t); j++) {
+            diff |= s_bonds[i].addr[j] ^ addr[j];
+        }
+        found = (diff == 0) ? i : found;
+    }
+    return found;
+}
+
+/** 写入绑定表（NVS，约 10-50ms）；先在锁内复制快照 */
+static void bond_table_save(void)
+{
+    bond_blob_t blob = { .version = BOND_BLOB_VERSION };
+
+    portENTER_CRITICAL(&s_bond_mux);
+    for (int i = 0; i < BLE_MAX_BONDS; i++) {
+        if (s_bonds[i].used) {
+            blob.entries[blob.count++] = s_bonds[i];
+        }
+    }
+    s_bonds_dirty = false;
+    portEXIT_CRITICAL(&s_bond_mux);
+
     nvs_handle_t nvs_handle;
     esp_err_t err = nvs_open(BINDING_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
     if (err != ESP_OK) {
@@ -809,83 +2254,298 @@ static void save_binding_info(void)
         return;
     }
 
-    err = nvs_set_str(nvs_handle, BINDING_NVS_KEY, addr_str);
+    size_t len = offsetof(bond_blob_t, entries) + blob.count * sizeof(bond_entry_t);
+    err = nvs_set_blob(nvs_handle, BINDING_NVS_TABLE_KEY, &blob, len);
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+
     if (err != ESP_OK) {
-        ESP_LOGW(TAG, "保存地址失败");
-        nvs_close(nvs_handle);
+        ESP_LOGW(TAG, "保存绑定表失败 %s", esp_err_to_name(err));
+    }
+}
+
+/** 连接建立时匹配绑定表，结果缓存到本次连接 */
+static void bond_on_connect(void)
+{
+    portENTER_CRITICAL(&s_bond_mux);
+    int idx = bond_find_locked(s_current_remote_addr);
+    s_conn_bond = idx;
+    s_conn_authorized = idx >= 0;
+    if (idx >= 0) {
+        s_bonds[idx].last_seen = (uint32_t)time(NULL);
+        s_bonds_dirty = true;
+    }
+    portEXIT_CRITICAL(&s_bond_mux);
+}
+
+/** 连接断开时在 BTC 任务中清除匹配结果，与 bond_on_connect 同一上下文，不会覆盖回连的结果；
+ *  本次连接更新的元数据由 ble_worker 随后持久化 */
+static void bond_on_disconnect(void)
+{
+    portENTER_CRITICAL(&s_bond_mux);
+    s_conn_bond = -1;
+    s_conn_authorized = false;
+    portEXIT_CRITICAL(&s_bond_mux);
+}
+
+/** 本次连接收下 count 条消息（ble_worker） */
+static void bond_count_messages(int count)
+{
+    portENTER_CRITICAL(&s_bond_mux);
+    if (s_conn_bond >= 0 && s_bonds[s_conn_bond].used) {
+        s_bonds[s_conn_bond].msg_count += count;
+        s_bonds_dirty = true;
+    }
+    portEXIT_CRITICAL(&s_bond_mux);
+}
+
+/** 从绑定 JSON 中取出 "name" 字段（不依赖 JSON 库，只处理简单字符串值） */
+static void binding_name_from_json(const char* json, char* out, size_t out_size)
+{
+    out[0] = '\0';
+    const char* p = strstr(json, "\"name\"");
+    if (!p) {
         return;
     }
+    p = strchr(p + 6, ':');
+    if (!p) {
+        return;
+    }
+    p = strchr(p, '"');
+    if (!p) {
+        return;
+    }
+    p++;
 
-    if (strlen(s_bound_device_name) > 0) {
-        nvs_set_str(nvs_handle, BINDING_NVS_NAME_KEY, s_bound_device_name);
+    size_t n = 0;
+    while (*p && *p != '"' && n + 1 < out_size) {
+        out[n++] = *p++;
     }
+    out[n] = '\0';
+}
 
-    nvs_commit(nvs_handle);
-    nvs_close(nvs_handle);
+static void save_binding_info(const char* info)
+{
+    if (!s_ble_connected || s_conn_id == 0xFFFF || !s_current_addr_valid) {
+        ESP_LOGW(TAG, "无法保存绑定信息: 未连接或无有效地址");
+        return;
+    }
 
-    strncpy(s_bound_device_addr, addr_str, sizeof(s_bound_device_addr) - 1);
+    bond_entry_t entry = {
+        .used = 1,
+        .addr_type = (uint8_t)s_current_addr_type,
+        .last_seen = (uint32_t)time(NULL),
+    };
+    memcpy(entry.addr, s_current_remote_addr, sizeof(esp_bd_addr_t));
+    binding_name_from_json(info, entry.name, sizeof(entry.name));
+
+    portENTER_CRITICAL(&s_bond_mux);
+    int idx = bond_find_locked(entry.addr);
+    if (idx >= 0) {
+        // 重复绑定：更新信息，保留消息计数
+        entry.msg_count = s_bonds[idx].msg_count;
+    } else {
+        // 找空位；表满时替换最久未连接的手机（仅在未启用接受列表过滤时会走到）
+        for (int i = 0; i < BLE_MAX_BONDS; i++) {
+            if (!s_bonds[i].used) {
+                idx = i;
+                break;
+            }
+            if (idx < 0 || s_bonds[i].last_seen < s_bonds[idx].last_seen) {
+                idx = i;
+            }
+        }
+    }
+    s_bonds[idx] = entry;
+    s_conn_bond = idx;
+    s_conn_authorized = true;
     s_is_bound = true;
-    ESP_LOGI(TAG, "绑定成功 %s", addr_str);
+    portEXIT_CRITICAL(&s_bond_mux);
+
+    // 每次绑定都重新开始序号空间：新手机与原主人无关，重新绑定的手机（重装应用 / 清除数据）
+    // 可能从 0 重新计数，落在旧窗口内的序号会被误判为重复而丢弃
+    memset(&s_seq_windows[idx], 0, sizeof(s_seq_windows[idx]));
+
+    s_accept_list_dirty = true;
+    bond_table_save();
+    ESP_LOGI(TAG, "绑定成功 " ESP_BD_ADDR_STR " (%s) 槽位 %d",
+             ESP_BD_ADDR_HEX(entry.addr), entry.name, idx);
 }
 
+/** 解除当前连接手机的绑定，其他手机不受影响 */
 static void clear_binding_info(void)
 {
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(BINDING_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    if (err != ESP_OK) {
+    portENTER_CRITICAL(&s_bond_mux);
+    int idx = s_conn_bond;
+    if (idx >= 0) {
+        memset(&s_bonds[idx], 0, sizeof(s_bonds[idx]));
+    }
+    s_conn_bond = -1;
+    s_conn_authorized = false;  // 立即失效，不等到稍后的断开
+    s_is_bound = bond_count_locked() > 0;
+    portEXIT_CRITICAL(&s_bond_mux);
+
+    if (idx < 0) {
+        ESP_LOGW(TAG, "当前连接不在绑定表中");
         return;
     }
+    memset(&s_seq_windows[idx], 0, sizeof(s_seq_windows[idx]));
 
-    nvs_erase_key(nvs_handle, BINDING_NVS_KEY);
-    nvs_erase_key(nvs_handle, BINDING_NVS_NAME_KEY);
-    nvs_commit(nvs_handle);
-    nvs_close(nvs_handle);
+    s_accept_list_dirty = true;
+    bond_table_save();
+    ESP_LOGI(TAG, "解绑成功，槽位 %d", idx);
+}
 
-    memset(s_bound_device_addr, 0, sizeof(s_bound_device_addr));
-    memset(s_bound_device_name, 0, sizeof(s_bound_device_name));
-    s_is_bound = false;
-    ESP_LOGI(TAG, "解绑成功");
+/** 从旧格式（单个手机，字符串地址）迁移 */
+static bool load_legacy_binding(nvs_handle_t nvs_handle, bond_entry_t* out)
+{
+    char addr_str[18] = {0};
+    size_t len = sizeof(addr_str);
+    if (nvs_get_str(nvs_handle, BINDING_NVS_KEY, addr_str, &len) != ESP_OK) {
+        return false;
+    }
+
+    unsigned int b[6];
+    if (sscanf(addr_str, "%02x:%02x:%02x:%02x:%02x:%02x",
+               &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6) {
+        return false;
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->used = 1;
+    for (int i = 0; i < 6; i++) {
+        out->addr[i] = (uint8_t)b[i];
+    }
+
+    uint8_t addr_type;
+    out->addr_type = (nvs_get_u8(nvs_handle, BINDING_NVS_TYPE_KEY, &addr_type) == ESP_OK)
+                     ? addr_type : BOND_ADDR_TYPE_UNKNOWN;
+
+    len = sizeof(out->name);
+    if (nvs_get_str(nvs_handle, BINDING_NVS_NAME_KEY, out->name, &len) != ESP_OK) {
+        out->name[0] = '\0';
+    }
+    return true;
 }
 
 static void load_binding_info(void)
 {
     nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(BINDING_NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
+    esp_err_t err = nvs_open(BINDING_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
     if (err != ESP_OK) {
         return;
     }
 
-    size_t required_size = 0;
-    err = nvs_get_str(nvs_handle, BINDING_NVS_KEY, NULL, &required_size);
-    if (err == ESP_OK && required_size > 0) {
-        err = nvs_get_str(nvs_handle, BINDING_NVS_KEY, s_bound_device_addr, &required_size);
-        if (err == ESP_OK) {
-            s_is_bound = true;
-        }
+    memset(s_bonds, 0, sizeof(s_bonds));
+
+    bond_blob_t blob;
+    size_t len = sizeof(blob);
+    bool migrated = false;
+    err = nvs_get_blob(nvs_handle, BINDING_NVS_TABLE_KEY, &blob, &len);
+    if (err == ESP_OK && blob.version == BOND_BLOB_VERSION && blob.count <= BLE_MAX_BONDS &&
+        len >= offsetof(bond_blob_t, entries) + blob.count * sizeof(bond_entry_t)) {
+        memcpy(s_bonds, blob.entries, blob.count * sizeof(bond_entry_t));
+    } else if (load_legacy_binding(nvs_handle, &s_bonds[0])) {
+        ESP_LOGI(TAG, "迁移旧版绑定 " ESP_BD_ADDR_STR, ESP_BD_ADDR_HEX(s_bonds[0].addr));
+        migrated = true;
     }
+    nvs_close(nvs_handle);
 
-    required_size = 0;
-    err = nvs_get_str(nvs_handle, BINDING_NVS_NAME_KEY, NULL, &required_size);
-    if (err == ESP_OK && required_size > 0) {
-        nvs_get_str(nvs_handle, BINDING_NVS_NAME_KEY, s_bound_device_name, &required_size);
+    // 先写入新格式再擦除旧键，中途掉电时下次启动会重新迁移
+    if (migrated) {
+        bond_table_save();
+        if (nvs_open(BINDING_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
+            nvs_erase_key(nvs_handle, BINDING_NVS_KEY);
+            nvs_erase_key(nvs_handle, BINDING_NVS_NAME_KEY);
+            nvs_erase_key(nvs_handle, BINDING_NVS_TYPE_KEY);
+            nvs_commit(nvs_handle);
+            nvs_close(nvs_handle);
+        }
     }
 
-    nvs_close(nvs_handle);
+    s_is_bound = bond_count_locked() > 0;
+    s_accept_list_dirty = true;
+    ESP_LOGI(TAG, "已绑定手机 %d 台", bond_count_locked());
 }
 
+/** 当前连接是否来自已绑定手机（连接时匹配一次并缓存） */
 static bool check_binding_match(void)
 {
-    if (!s_is_bound || !ble_is_connected || !s_current_addr_valid) {
-        return false;
+    return s_conn_authorized && ble_is_connected;
+}
+
+/**
+ * @brief 绑定地址是否为固定身份地址（公共地址或静态随机地址）
+ *
+ * 手机通常使用可解析私有地址（RPA）并定期更换；未配对时设备没有 IRK 无法解析，
+ * 把 RPA 放进接受列表会在地址轮换后把绑定手机拒之门外，因此只对身份地址启用过滤。
+ */
+static bool bond_is_identity(const bond_entry_t* b)
+{
+    if (b->addr_type == BLE_ADDR_TYPE_PUBLIC) {
+        return true;
     }
-    
-    // 将当前地址转换为字符串
-    char current_addr[18];
-    snprintf(current_addr, sizeof(current_addr), "%02x:%02x:%02x:%02x:%02x:%02x",
-             s_current_remote_addr[0], s_current_remote_addr[1], s_current_remote_addr[2],
-             s_current_remote_addr[3], s_current_remote_addr[4], s_current_remote_addr[5]);
-    
-    return (strcmp(current_addr, s_bound_device_addr) == 0);
+    // 静态随机地址最高两位为 11
+    return b->addr_type == BLE_ADDR_TYPE_RANDOM && (b->addr[0] & 0xC0) == 0xC0;
+}
+
+/**
+ * @brief 按绑定表同步控制器接受列表（仅在未广播时调用）
+ *
+ * 只有全部绑定手机都使用身份地址时才启用过滤，否则使用 RPA 的手机将无法连接。
+ */
+static void accept_list_sync(void)
+{
+    if (!s_accept_list_dirty) {
+        return;
+    }
+    s_accept_list_dirty = false;
+    s_accept_list_active = false;
+    s_accept_list_full = false;
+
+    esp_ble_gap_clear_whitelist();
+
+    bond_entry_t bonds[BLE_MAX_BONDS];
+    portENTER_CRITICAL(&s_bond_mux);
+    memcpy(bonds, s_bonds, sizeof(bonds));
+    portEXIT_CRITICAL(&s_bond_mux);
+
+    int count = 0;
+    for (int i = 0; i < BLE_MAX_BONDS; i++) {
+        if (!bonds[i].used) {
+            continue;
+        }
+        if (!bond_is_identity(&bonds[i])) {
+            ESP_LOGI(TAG, "绑定地址 " ESP_BD_ADDR_STR " 非固定身份地址，不启用接受列表过滤",
+                     ESP_BD_ADDR_HEX(bonds[i].addr));
+            return;
+        }
+        count++;
+    }
+    if (count == 0) {
+        return;
+    }
+
+    for (int i = 0; i < BLE_MAX_BONDS; i++) {
+        if (!bonds[i].used) {
+            continue;
+        }
+        esp_ble_wl_addr_type_t wl_type = (bonds[i].addr_type == BLE_ADDR_TYPE_PUBLIC)
+                                         ? BLE_WL_ADDR_TYPE_PUBLIC : BLE_WL_ADDR_TYPE_RANDOM;
+        esp_err_t ret = esp_ble_gap_update_whitelist(true, bonds[i].addr, wl_type);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "添加接受列表失败: %s", esp_err_to_name(ret));
+            esp_ble_gap_clear_whitelist();
+            return;
+        }
+    }
+
+    s_accept_list_active = true;
+    s_accept_list_full = count >= BLE_MAX_BONDS;
+    ESP_LOGI(TAG, "接受列表: %d 台，%s", count,
+             s_accept_list_full ? "全部档位过滤" : "仅快速档位过滤（可绑定新手机）");
 }
 
 
@@ -938,11 +2598,23 @@ esp_err_t ble_manager_init(void)
 
     // 生成设备名称
     generate_device_name();
+    adv_data_invalidate();
     ESP_LOGI(TAG, "设备名称: %s", s_device_name);
 
     // 加载绑定信息
     load_binding_info();
 
+    // 协议栈事件到来前先启动工作任务
+    esp_err_t worker_ret = ble_worker_start();
+    if (worker_ret == ESP_OK) {
+        worker_ret = adv_scheduler_init();
+    }
+    if (worker_ret != ESP_OK) {
+        ESP_LOGE(TAG, "工作任务启动失败: %s", esp_err_to_name(worker_ret));
+        update_ble_state(BLE_STATE_ERROR);
+        return worker_ret;
+    }
+
     // 带重试的安全初始化
     esp_err_t ret = ESP_FAIL;
     for (int i = 0; i < BLE_INIT_MAX_RETRIES; i++) {
@@ -973,12 +2645,12 @@ esp_err_t ble_manager_init(void)
 
 esp_err_t ble_manager_message_queue_init(void)
 {
-    if (s_msg_queue != NULL) {
+    if (s_msg_ring != NULL) {
         return ESP_OK;
     }
 
-    s_msg_queue = xQueueCreate(MSG_QUEUE_DEPTH, sizeof(ble_msg_event_t));
-    if (s_msg_queue == NULL) {
+    s_msg_ring = xRingbufferCreate(MSG_RING_SIZE, RINGBUF_TYPE_NOSPLIT);
+    if (s_msg_ring == NULL) {
         return ESP_ERR_NO_MEM;
     }
 
@@ -987,15 +2659,47 @@ esp_err_t ble_manager_message_queue_init(void)
 
 void ble_manager_process_pending_messages(void)
 {
-    if (s_msg_queue == NULL) {
+    if (s_msg_ring == NULL) {
         return;
     }
 
-    ble_msg_event_t evt;
-    while (xQueueReceive(s_msg_queue, &evt, 0) == pdTRUE) {
-        if (s_message_callback) {
-            s_message_callback(evt.sender, evt.body, evt.timestamp);
+    size_t size;
+    uint8_t* item;
+    while ((item = xRingbufferReceive(s_msg_ring, &size, 0)) != NULL) {
+        // 一项对应一帧，逐条还原指向缓冲区内部的消息视图
+        ble_message_t msgs[BLE_MESSAGE_BATCH_MAX];
+        size_t count = 0;
+        const char* sender = "";
+        size_t off = 0;
+        while (off + sizeof(ble_msg_record_t) <= size && count < BLE_MESSAGE_BATCH_MAX) {
+            const ble_msg_record_t* rec = (const ble_msg_record_t*)(item + off);
+            if (!(rec->flags & MSG_REC_FLAG_SAME_SENDER)) {
+                sender = rec->text;
+            }
+            msgs[count].sender = sender;
+            msgs[count].body = rec->text + rec->sender_len + 1;
+            msgs[count].timestamp = rec->timestamp;
+            count++;
+            off += MSG_RECORD_SIZE(rec->sender_len, rec->body_len);
+        }
+
+        if (s_message_batch_callback) {
+            s_message_batch_callback(msgs, count);
+        } else if (s_message_callback) {
+            for (size_t i = 0; i < count; i++) {
+                s_message_callback(msgs[i].sender, msgs[i].body, msgs[i].timestamp);
+            }
         }
+        vRingbufferReturnItem(s_msg_ring, item);
+
+        portENTER_CRITICAL(&s_msg_mux);
+        s_msg_inflight--;
+        portEXIT_CRITICAL(&s_msg_mux);
+    }
+
+    // 手机因额度耗尽已暂停：腾出空间后主动恢复
+    if (s_flow_paused && flow_credits() > 0) {
+        send_credit_update();
     }
 }
 
@@ -1028,9 +2732,9 @@ esp_err_t ble_manager_stop_advertising(void)
         return ESP_OK;
     }
 
-    // Bluedroid 中没有 stop_advertising，需要重新配置参数
-    // 实际上停止广告需要通过事件处理
-    return ESP_OK;
+    // 状态在 ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT 中更新
+    adv_session_end(false);
+    return esp_ble_gap_stop_advertising();
 }
 
 void ble_manager_set_message_callback(ble_message_callback_t callback)
@@ -1038,6 +2742,16 @@ void ble_manager_set_message_callback(ble_message_callback_t callback)
     s_message_callback = callback;
 }
 
+void ble_manager_set_message_batch_callback(ble_message_batch_callback_t callback)
+{
+    s_message_batch_callback = callback;
+}
+
+void ble_manager_set_pending_callback(void (*callback)(void))
+{
+    s_pending_callback = callback;
+}
+
 void ble_manager_set_time_sync_callback(ble_time_sync_callback_t callback)
 {
     s_time_sync_callback = callback;
@@ -1068,6 +2782,60 @@ uint32_t ble_manager_get_error_count(void)
     return s_error_count;
 }
 
+void ble_manager_get_stats(ble_manager_stats_t* out)
+{
+    if (!out) {
+        return;
+    }
+
+    *out = s_stats;
+    out->frames = s_rx_assembler.frames;
+    out->resync_bytes = s_rx_assembler.discarded_bytes;
+    out->queue_depth = s_cmd_queue ? (uint32_t)uxQueueMessagesWaiting(s_cmd_queue) : 0;
+
+    // 加上当前广播档位与连接模式尚未结算的停留时间
+    portENTER_CRITICAL(&s_adv_mux);
+    uint32_t* adv_counter = adv_tier_counter(out, s_adv_tier);
+    if (adv_counter) {
+        *adv_counter += now_ms() - s_adv_tier_since_ms;
+    }
+    portEXIT_CRITICAL(&s_adv_mux);
+
+    portENTER_CRITICAL(&s_conn_mux);
+    uint32_t spent = now_ms() - s_conn_mode_since_ms;
+    if (s_conn_mode == CONN_MODE_FAST) {
+        out->conn_fast_ms = s_stats.conn_fast_ms + spent;
+    } else if (s_conn_mode == CONN_MODE_IDLE) {
+        out->conn_idle_ms = s_stats.conn_idle_ms + spent;
+    }
+    portEXIT_CRITICAL(&s_conn_mux);
+}
+
+esp_err_t ble_manager_update_status_beacon(void)
+{
+    if (s_ble_state == BLE_STATE_UNINITIALIZED || s_ble_state == BLE_STATE_ERROR) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return beacon_refresh();
+}
+
+esp_err_t ble_manager_get_link_info(ble_manager_link_info_t* out)
+{
+    if (!out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_ble_connected) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    out->tx_phy = s_link_tx_phy;
+    out->rx_phy = s_link_rx_phy;
+    out->tx_data_len = s_link_tx_len;
+    out->rx_data_len = s_link_rx_len;
+    out->mtu = s_mtu;
+    return ESP_OK;
+}
+
 void ble_manager_poll(void)
 {
     /* Bluedroid事件驱动，无需轮询 */
@@ -1101,7 +2869,7 @@ esp_err_t ble_manager_send_time_sync_response(uint32_t timestamp)
         return ESP_FAIL;
     }
 
-    esp_err_t ret = nus_tx_notify(buffer, packet_length);
+    esp_err_t ret = nus_tx_notify(buffer, packet_length, TX_PRIO_BULK);
     if (ret != ESP_OK) {
         return ret;
     }
@@ -1109,16 +2877,51 @@ esp_err_t ble_manager_send_time_sync_response(uint32_t timestamp)
     return ESP_OK;
 }
 
+int ble_manager_get_bonds(ble_bond_info_t* out, int max)
+{
+    if (!out || max <= 0) {
+        return 0;
+    }
+
+    int n = 0;
+    portENTER_CRITICAL(&s_bond_mux);
+    for (int i = 0; i < BLE_MAX_BONDS && n < max; i++) {
+        if (!s_bonds[i].used) {
+            continue;
+        }
+        memcpy(out[n].addr, s_bonds[i].addr, sizeof(out[n].addr));
+        memcpy(out[n].name, s_bonds[i].name, sizeof(out[n].name));
+        out[n].name[sizeof(out[n].name) - 1] = '\0';
+        out[n].last_seen = s_bonds[i].last_seen;
+        out[n].msg_count = s_bonds[i].msg_count;
+        n++;
+    }
+    portEXIT_CRITICAL(&s_bond_mux);
+    return n;
+}
+
 void ble_manager_force_reset_bonds(void)
 {
-    clear_binding_info();
+    // 本地解绑清空整张绑定表
+    portENTER_CRITICAL(&s_bond_mux);
+    memset(s_bonds, 0, sizeof(s_bonds));
+    s_conn_bond = -1;
+    s_conn_authorized = false;
+    s_is_bound = false;
+    portEXIT_CRITICAL(&s_bond_mux);
+    s_accept_list_dirty = true;
+    bond_table_save();
+    ESP_LOGI(TAG, "已清除全部绑定");
 
     if (s_ble_connected && s_conn_id != 0xFFFF) {
         esp_ble_gatts_close(s_gatts_if, s_conn_id);
         ble_is_connected = false;
     }
 
-    s_is_bound = false;
-    memset(s_bound_device_addr, 0, sizeof(s_bound_device_addr));
-    memset(s_bound_device_name, 0, sizeof(s_bound_device_name));
+    // 正在过滤广播时需重启广播，否则其他手机仍无法连接
+    if (s_accept_list_active && s_ble_state == BLE_STATE_ADVERTISING) {
+        s_adv_restart = true;
+        adv_session_end(false);
+        esp_ble_gap_stop_advertising();
+    }
 }
@@ -0,0 +1,138 @@
+/*
+ * 接收帧解析基准（主机端）
+ *
+ * 对比 bipupu_protocol_parse()（填充约 800 字节的结构体，拷贝并清洗发送者 / 正文）与
+ * bipupu_protocol_parse_view()（原地校验，只返回指针 / 长度）：
+ *   - 吞吐：137 字节 TEXT 帧，结构体解析 / 视图 + 拷贝两个字段 / 仅视图
+ *   - 栈占用：两种解析结果的 sizeof（视图大小依赖指针宽度，主机为 64 位）
+ *   - 一致性：随机帧上两者的接受 / 拒绝判定、发送者拆分与清洗后的正文必须相同，
+ *     不一致时退出码非 0（结构体解析原样拷贝发送者，视图路径另做 UTF-8 清洗，
+ *     因此发送者按原始字节比较）
+ */
+#include "bipupu_protocol.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_FRAMES   2000000
+#define RANDOM_FRAMES  200000
+
+static volatile int s_sink;
+
+/* 按协议格式组帧：[0xB0][时间戳(4)][类型(1)][长度(2)][数据][校验和] */
+static size_t make_frame(uint8_t* buf, uint8_t type, const uint8_t* data, uint16_t len) {
+    buf[0] = BIPUPU_PROTOCOL_HEADER;
+    buf[1] = 0x01;
+    buf[2] = 0x02;
+    buf[3] = 0x03;
+    buf[4] = 0x04;
+    buf[5] = type;
+    buf[6] = (uint8_t)(len & 0xFF);
+    buf[7] = (uint8_t)(len >> 8);
+    memcpy(&buf[8], data, len);
+    buf[8 + len] = bipupu_protocol_calculate_checksum(buf, 8 + (size_t)len);
+    return 9 + (size_t)len;
+}
+
+static size_t make_text_frame(uint8_t* buf, const char* sender, const char* body) {
+    uint8_t data[BIPUPU_MAX_DATA_LENGTH];
+    size_t sl = strlen(sender), bl = strlen(body);
+    data[0] = (uint8_t)sl;
+    memcpy(&data[1], sender, sl);
+    memcpy(&data[1 + sl], body, bl);
+    return make_frame(buf, BIPUPU_MSG_TEXT, data, (uint16_t)(1 + sl + bl));
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* 随机帧（合法 / 非法长度、随机 sender_len、含非法 UTF-8）上两种解析结果必须一致 */
+static int check_equivalence(void) {
+    static bipupu_parsed_packet_t parsed;
+    uint8_t frame[BIPUPU_MAX_PACKET_LENGTH];
+    uint8_t data[BIPUPU_MAX_DATA_LENGTH];
+
+    srand(1);
+    for (int k = 0; k < RANDOM_FRAMES; k++) {
+        uint16_t len = (uint16_t)(rand() % (BIPUPU_MAX_DATA_LENGTH + 1));
+        for (int i = 0; i < len; i++) {
+            data[i] = (rand() % 3 == 0) ? (uint8_t)rand() : (uint8_t)('a' + rand() % 26);
+        }
+        if (len > 0 && rand() % 2) data[0] = (uint8_t)(rand() % 80);
+        size_t n = make_frame(frame, BIPUPU_MSG_TEXT, data, len);
+        if (rand() % 16 == 0) frame[n - 1] ^= 0x5A;  // 偶尔破坏校验和
+
+        bipupu_packet_view_t view;
+        bool a = bipupu_protocol_parse(frame, n, &parsed);
+        bool b = bipupu_protocol_parse_view(frame, n, &view);
+        if (a != b) {
+            printf("FAIL: frame %d accepted by %s only\n", k, a ? "struct parser" : "view parser");
+            return 1;
+        }
+        if (!a) continue;
+
+        char body[sizeof(parsed.body_text)];
+        bipupu_protocol_copy_utf8(view.body.ptr, view.body.len, body, sizeof(body));
+        bool sender_same = view.sender.len < sizeof(parsed.sender_name) &&
+                           memcmp(view.sender.ptr, parsed.sender_name, view.sender.len) == 0 &&
+                           parsed.sender_name[view.sender.len] == '\0';
+        if (!sender_same || strcmp(body, parsed.body_text) != 0) {
+            printf("FAIL: frame %d fields differ (sender %s, body %s)\n", k,
+                   sender_same ? "same" : "differs", strcmp(body, parsed.body_text) ? "differs" : "same");
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(void) {
+    // 137 字节 TEXT 帧：5 字节发送者 + 110 字节 ASCII + 4 个汉字
+    char body[160] = {0};
+    for (int i = 0; i < 110; i++) body[i] = "abcdefghij"[i % 10];
+    strcat(body, "你好世界");
+    uint8_t frame[BIPUPU_MAX_PACKET_LENGTH];
+    size_t n = make_text_frame(frame, "Alice", body);
+
+    static bipupu_parsed_packet_t parsed;
+    double t = now_s();
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        bipupu_protocol_parse(frame, n, &parsed);
+        s_sink += parsed.body_text[0];
+    }
+    double t_struct = now_s() - t;
+
+    char sender[sizeof(parsed.sender_name)];
+    char text[sizeof(parsed.body_text)];
+    t = now_s();
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        bipupu_packet_view_t view;
+        bipupu_protocol_parse_view(frame, n, &view);
+        bipupu_protocol_copy_utf8(view.sender.ptr, view.sender.len, sender, sizeof(sender));
+        bipupu_protocol_copy_utf8(view.body.ptr, view.body.len, text, sizeof(text));
+        s_sink += text[0];
+    }
+    double t_copy = now_s() - t;
+
+    t = now_s();
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        bipupu_packet_view_t view;
+        bipupu_protocol_parse_view(frame, n, &view);
+        s_sink += view.body.ptr[0];
+    }
+    double t_view = now_s() - t;
+
+    printf("frame: %zu bytes TEXT\n", n);
+    printf("struct parser         : %6.2f M frames/s\n", BENCH_FRAMES / t_struct / 1e6);
+    printf("view + copy 2 fields  : %6.2f M frames/s\n", BENCH_FRAMES / t_copy / 1e6);
+    printf("view only             : %6.2f M frames/s\n", BENCH_FRAMES / t_view / 1e6);
+    printf("sizeof bipupu_parsed_packet_t = %zu, bipupu_packet_view_t = %zu (%zu-bit host)\n",
+           sizeof(bipupu_parsed_packet_t), sizeof(bipupu_packet_view_t), sizeof(void*) * 8);
+
+    int failed = check_equivalence();
+    if (!failed) printf("equivalence: %d random frames OK\n", RANDOM_FRAMES);
+    return failed;
+}
@@ -0,0 +1,13 @@
+#pragma once
+/* 主机基准用的 esp_log.h 桩：日志全部丢弃，参数仍参与类型检查 */
+#include <stdio.h>
+
+static inline __attribute__((format(printf, 1, 2))) void esp_log_discard(const char* fmt, ...) {
+    (void)fmt;
+}
+
+#define ESP_LOGE(tag, fmt, ...) do { (void)(tag); esp_log_discard(fmt, ##__VA_ARGS__); } while (0)
+#define ESP_LOGW(tag, fmt, ...) do { (void)(tag); esp_log_discard(fmt, ##__VA_ARGS__); } while (0)
+#define ESP_LOGI(tag, fmt, ...) do { (void)(tag); esp_log_discard(fmt, ##__VA_ARGS__); } while (0)
+#define ESP_LOGD(tag, fmt, ...) do { (void)(tag); esp_log_discard(fmt, ##__VA_ARGS__); } while (0)
+#define ESP_LOGV(tag, fmt, ...) do { (void)(tag); esp_log_discard(fmt, ##__VA_ARGS__); } while (0)
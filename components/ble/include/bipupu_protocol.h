@@ -8,6 +8,36 @@
  * 协议头: 0xB0 (固定值)
  * 字节序: 小端序
  * 校验和: 异或校验 (XOR)
+ *
+ * 流控（设备 → 手机）:
+ *   ACK    数据 [消息ID(4)][额度(1)]          额度为设备还能接收的 TEXT 消息条数
+ *   NACK   数据 [消息ID(4)][原因(1)][额度(1)]  消息未被接收，手机应暂停并在收到 CREDIT 后重发
+ *   CREDIT 数据 [额度(1)]                     额度从 0 恢复时（以及启用通知时）主动下发
+ * 手机在额度用完后暂停发送 TEXT，收到额度 > 0 的 ACK / CREDIT 后恢复。
+ * 旧版手机只读取 ACK 的前 4 字节，不受影响。
+ *
+ * 版本协商:
+ *   HELLO  手机 → 设备 [版本(1)][特性(1)]，设备回复 [版本(1)][双方共同支持的特性(1)][额度(1)]
+ *   未发送 HELLO 的手机按 1.2 处理，只使用上面的逐条 ACK。
+ *   BIPUPU_FEATURE_BATCH_ACK: 设备把短时间内收到的多条消息合并为一个
+ *   BATCH_ACK [额度(1)][条数(1)][消息ID(4) × 条数]，延迟不超过设备的合并窗口。
+ *
+ * 批量消息 (BATCH，手机 → 设备，BIPUPU_FEATURE_BATCH_TEXT):
+ *   数据 [条数(1)] 后接每条记录 [时间偏移 varint][sender_len(1)][body_len(1)][sender][body]
+ *   时间戳 = 帧头时间戳 + 时间偏移；sender_len = 0 表示 "App"，0xFF 表示与上一条相同。
+ *   整帧占一个接收额度，以帧头时间戳为消息 ID 确认一次。
+ *
+ * 消息序号 (BIPUPU_FEATURE_SEQ):
+ *   TEXT_SEQ / BATCH_SEQ 的数据为 [序号(4)] 后接 TEXT / BATCH 的数据。序号由手机按绑定关系
+ *   单调递增（32 位回绕），并代替帧头时间戳作为 ACK / NACK / BATCH_ACK 中的消息 ID，
+ *   同一秒内的多条消息不再冲突。设备记住最近收下的序号，重传的消息只确认、不重复入队。
+ *   每次绑定（BINDING_INFO，包括同一手机重新绑定）都开始新的序号空间，手机可从 0 重新计数。
+ *   设备只在内存中记录序号窗口，重启后丢失：重启前已收下的消息若被重传会再次入队。
+ *
+ * 状态信标（扫描响应中的厂商数据，无需连接即可读取）:
+ *   [公司ID 0xFFFF(2)][0xB0][协议版本(1)][未读条数(1)][电量%(1)][收件箱序号(2)]
+ *   收件箱序号在设备收下 / 删除 / 已读消息时递增（取低 16 位）；
+ *   手机可据此判断设备状态是否变化，没有待发消息时不必连接。
  */
 
 #pragma once
@@ -25,6 +55,29 @@ extern "C" {
 /** 协议头固定值 */
 #define BIPUPU_PROTOCOL_HEADER 0xB0
 
+/** 协议版本（高 4 位主版本，低 4 位次版本：0x14 = 1.4） */
+#define BIPUPU_PROTOCOL_VERSION 0x14
+
+/** 特性位（HELLO 中协商） */
+#define BIPUPU_FEATURE_BATCH_ACK  0x01    /**< 合并 ACK */
+#define BIPUPU_FEATURE_BATCH_TEXT 0x02    /**< 批量消息帧 */
+#define BIPUPU_FEATURE_SEQ        0x04    /**< 带序号的消息帧 */
+
+/** 状态信标使用的公司 ID（0xFFFF 为测试 / 内部用途保留值） */
+#define BIPUPU_BEACON_COMPANY_ID 0xFFFF
+
+/** 状态信标厂商数据长度（含公司 ID） */
+#define BIPUPU_BEACON_LENGTH 8
+
+/** 单个 BATCH 帧最多包含的消息条数 */
+#define BIPUPU_BATCH_MAX_RECORDS 8
+
+/** BATCH 记录中表示“发送者与上一条相同”的 sender_len */
+#define BIPUPU_BATCH_SAME_SENDER 0xFF
+
+/** 单个 BATCH_ACK 最多确认的消息条数 */
+#define BIPUPU_BATCH_ACK_MAX 16
+
 /** 最大数据长度 (受蓝牙MTU限制) */
 #define BIPUPU_MAX_DATA_LENGTH 240
 
@@ -37,6 +90,9 @@ extern "C" {
 /** 最小数据包长度 */
 #define BIPUPU_MIN_PACKET_LENGTH (BIPUPU_HEADER_LENGTH + BIPUPU_CHECKSUM_LENGTH)
 
+/** 最大数据包长度 */
+#define BIPUPU_MAX_PACKET_LENGTH (BIPUPU_HEADER_LENGTH + BIPUPU_MAX_DATA_LENGTH + BIPUPU_CHECKSUM_LENGTH)
+
 /* ================== 消息类型定义 ================== */
 
 /** 消息类型枚举 */
@@ -45,9 +101,21 @@ typedef enum {
     BIPUPU_MSG_TEXT = 0x02,           /**< 文本消息 */
     BIPUPU_MSG_ACKNOWLEDGEMENT = 0x03, /**< 确认响应 (预留) */
     BIPUPU_MSG_BINDING_INFO = 0x04,   /**< 绑定信息交换 */
-    BIPUPU_MSG_UNBIND_COMMAND = 0x05  /**< 解绑命令 */
+    BIPUPU_MSG_UNBIND_COMMAND = 0x05, /**< 解绑命令 */
+    BIPUPU_MSG_NACK = 0x06,           /**< 拒绝响应（设备 → 手机） */
+    BIPUPU_MSG_CREDIT = 0x07,         /**< 接收额度更新（设备 → 手机） */
+    BIPUPU_MSG_BATCH_ACK = 0x08,      /**< 合并确认（设备 → 手机） */
+    BIPUPU_MSG_HELLO = 0x09,          /**< 版本与特性协商 */
+    BIPUPU_MSG_BATCH = 0x0A,          /**< 批量文本消息 */
+    BIPUPU_MSG_TEXT_SEQ = 0x0B,       /**< 带序号的文本消息（解析后归一为 TEXT） */
+    BIPUPU_MSG_BATCH_SEQ = 0x0C       /**< 带序号的批量文本消息（解析后归一为 BATCH） */
 } bipupu_message_type_t;
 
+/** NACK 原因 */
+typedef enum {
+    BIPUPU_NACK_BUSY = 0x01           /**< 接收缓冲已满，稍后重发 */
+} bipupu_nack_reason_t;
+
 /* ================== 解析结果结构 ================== */
 
 /** 解析后的数据包结构 */
@@ -71,6 +139,30 @@ typedef struct {
 
 /* ================== 协议解析接口 ================== */
 
+/* ── 零拷贝视图 ──────────────────────────────────────────────────────────────
+ * bipupu_protocol_parse_view() 在原始缓冲区上原地校验，只返回指向原始数据的
+ * 指针 / 长度，不做拷贝和 UTF-8 解码；视图的生命周期与原始缓冲区相同，
+ * 需要保留的字段由调用方用 bipupu_protocol_copy_utf8() 按需拷贝。
+ */
+
+/** 指向原始数据包内部的一段字节 */
+typedef struct {
+    const uint8_t* ptr;
+    uint16_t len;
+} bipupu_span_t;
+
+/** 数据包视图（32 位平台上 40 字节） */
+typedef struct {
+    uint32_t timestamp;                 /**< Unix时间戳 (秒) */
+    bipupu_message_type_t message_type; /**< 消息类型（TEXT_SEQ / BATCH_SEQ 归一为 TEXT / BATCH） */
+    uint32_t seq;                       /**< 消息序号，仅 has_seq 时有效 */
+    bool has_seq;                       /**< 帧中带有序号（payload 已跳过序号字段） */
+    bipupu_span_t payload;              /**< 数据部分 */
+    bipupu_span_t sender;               /**< TEXT：发送者（sender_len = 0 或非法时指向 "App"） */
+    bipupu_span_t body;                 /**< TEXT：消息正文（未做 UTF-8 清洗） */
+} bipupu_packet_view_t;
+
+
 /**
  * @brief 解析Bipupu蓝牙数据包
  * 
@@ -81,6 +173,51 @@ typedef struct {
  */
 bool bipupu_protocol_parse(const uint8_t* data, size_t length, bipupu_parsed_packet_t* result);
 
+/** BATCH 帧中的一条消息（发送者 / 正文指向原始数据包，未做 UTF-8 清洗） */
+typedef struct {
+    uint32_t timestamp;
+    bipupu_span_t sender;
+    bipupu_span_t body;
+} bipupu_batch_record_t;
+
+/**
+ * @brief 原地校验数据包并生成零拷贝视图
+ *
+ * 校验规则与 bipupu_protocol_parse() 相同（协议头、长度、校验和），
+ * TEXT 消息的发送者 / 正文拆分规则也相同。
+ *
+ * @param data 接收到的原始数据（视图指向其内部，调用方须保证其有效）
+ * @param length 数据长度
+ * @param view 视图输出
+ * @return true 解析成功，false 解析失败
+ */
+bool bipupu_protocol_parse_view(const uint8_t* data, size_t length, bipupu_packet_view_t* view);
+
+/**
+ * @brief 一次遍历拆出 BATCH 帧中的全部记录
+ *
+ * 任一记录越界、sender_len 非法或条数与实际不符时整帧无效，不返回部分结果。
+ *
+ * @param view bipupu_protocol_parse_view() 得到的 BATCH 视图
+ * @param records 输出数组（至少 BIPUPU_BATCH_MAX_RECORDS 项）
+ * @return int 记录条数，无效时返回 -1
+ */
+int bipupu_protocol_parse_batch(const bipupu_packet_view_t* view, bipupu_batch_record_t* records);
+
+/**
+ * @brief 将 UTF-8 字节串清洗后拷贝到定长缓冲区
+ *
+ * 与 bipupu_protocol_decode_utf8_safe() 的清洗规则相同，但按 output_size 截断，
+ * 且不会截断在多字节字符中间。
+ *
+ * @param data UTF-8编码的字节数组
+ * @param length 数据长度
+ * @param output 输出缓冲区（总是以 '\0' 结尾）
+ * @param output_size 输出缓冲区大小
+ * @return size_t 写入的字节数（不含结尾 '\0'）
+ */
+size_t bipupu_protocol_copy_utf8(const uint8_t* data, size_t length, char* output, size_t output_size);
+
 /**
  * @brief 计算数据包的校验和
  * 
@@ -143,6 +280,67 @@ size_t bipupu_protocol_create_unbind_confirm(uint32_t timestamp, uint8_t* buffer
  */
 size_t bipupu_protocol_create_acknowledgement(uint32_t original_message_id, uint8_t* buffer, size_t buffer_size);
 
+/**
+ * @brief 创建携带接收额度的 ACK 数据包
+ * 
+ * @param original_message_id 原始消息 ID（时间戳）
+ * @param credits 设备当前还能接收的消息条数
+ * @param buffer 输出缓冲区
+ * @param buffer_size 缓冲区大小
+ * @return size_t 实际写入的字节数，0 表示失败
+ */
+size_t bipupu_protocol_create_ack_with_credits(uint32_t original_message_id, uint8_t credits,
+                                               uint8_t* buffer, size_t buffer_size);
+
+/**
+ * @brief 创建 NACK 数据包
+ * 
+ * @param original_message_id 被拒绝的消息 ID（时间戳）
+ * @param reason 拒绝原因
+ * @param credits 设备当前还能接收的消息条数（通常为 0）
+ * @param buffer 输出缓冲区
+ * @param buffer_size 缓冲区大小
+ * @return size_t 实际写入的字节数，0 表示失败
+ */
+size_t bipupu_protocol_create_nack(uint32_t original_message_id, bipupu_nack_reason_t reason,
+                                   uint8_t credits, uint8_t* buffer, size_t buffer_size);
+
+/**
+ * @brief 创建接收额度更新数据包
+ * 
+ * @param credits 设备当前还能接收的消息条数
+ * @param buffer 输出缓冲区
+ * @param buffer_size 缓冲区大小
+ * @return size_t 实际写入的字节数，0 表示失败
+ */
+size_t bipupu_protocol_create_credit(uint8_t credits, uint8_t* buffer, size_t buffer_size);
+
+/**
+ * @brief 创建合并确认数据包
+ * 
+ * @param message_ids 被确认的消息 ID（时间戳）数组
+ * @param count 条数 (1 ~ BIPUPU_BATCH_ACK_MAX)
+ * @param credits 设备当前还能接收的消息条数
+ * @param buffer 输出缓冲区
+ * @param buffer_size 缓冲区大小
+ * @return size_t 实际写入的字节数，0 表示失败
+ */
+size_t bipupu_protocol_create_batch_ack(const uint32_t* message_ids, uint8_t count, uint8_t credits,
+                                        uint8_t* buffer, size_t buffer_size);
+
+/**
+ * @brief 创建 HELLO 应答数据包
+ * 
+ * @param version 设备协议版本
+ * @param features 协商后的特性位
+ * @param credits 设备当前还能接收的消息条数
+ * @param buffer 输出缓冲区
+ * @param buffer_size 缓冲区大小
+ * @return size_t 实际写入的字节数，0 表示失败
+ */
+size_t bipupu_protocol_create_hello(uint8_t version, uint8_t features, uint8_t credits,
+                                    uint8_t* buffer, size_t buffer_size);
+
 /**
  * @brief 验证数据包的基本有效性
  * 
@@ -161,6 +359,54 @@ bool bipupu_protocol_validate_packet(const uint8_t* data, size_t length);
  */
 size_t bipupu_protocol_get_packet_length(const uint8_t* data, size_t length);
 
+/* ================== 流式帧组装 ================== */
+
+/**
+ * 写入与帧边界无关：一次写入可以只含半帧，也可以含多帧。组装器把收到的字节放入
+ * 固定大小的环形缓冲区，按 0xB0 协议头和长度字段切出完整的帧；遇到非协议头字节、
+ * 超长长度字段或校验失败时逐字节丢弃，直到重新对齐到下一个协议头。
+ */
+
+/** 环形缓冲区大小（2 的幂，至少容纳一帧加一次写入的余量） */
+#define BIPUPU_ASSEMBLER_RING_SIZE 512
+
+/**
+ * @brief 完整帧回调
+ *
+ * @param frame 完整数据包（已通过协议头、长度与校验和检查），仅在回调期间有效
+ * @param length 数据包长度
+ * @param ctx bipupu_assembler_feed() 传入的上下文
+ */
+typedef void (*bipupu_frame_handler_t)(const uint8_t* frame, size_t length, void* ctx);
+
+/** 帧组装器状态（不可重入，回调中不得再调用同一实例的 feed） */
+typedef struct {
+    uint8_t  ring[BIPUPU_ASSEMBLER_RING_SIZE]; /**< 未处理的字节 */
+    uint16_t head;                             /**< 环形缓冲区读位置 */
+    uint16_t count;                            /**< 环形缓冲区中的字节数 */
+    uint8_t  frame[BIPUPU_MAX_PACKET_LENGTH];  /**< 交给回调的线性帧缓冲 */
+    uint32_t frames;                           /**< 累计组装出的帧数 */
+    uint32_t discarded_bytes;                  /**< 累计为重新同步丢弃的字节数 */
+} bipupu_assembler_t;
+
+/**
+ * @brief 清空组装器中未完成的数据（统计计数保留）
+ */
+void bipupu_assembler_reset(bipupu_assembler_t* as);
+
+/**
+ * @brief 向组装器追加收到的字节，每切出一个完整帧调用一次 handler
+ *
+ * @param as 组装器
+ * @param data 收到的数据
+ * @param length 数据长度（任意长度，超出缓冲区时分段处理）
+ * @param handler 完整帧回调
+ * @param ctx 透传给回调的上下文
+ * @return size_t 本次交付的帧数
+ */
+size_t bipupu_assembler_feed(bipupu_assembler_t* as, const uint8_t* data, size_t length,
+                             bipupu_frame_handler_t handler, void* ctx);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
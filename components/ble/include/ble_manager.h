@@ -37,10 +37,34 @@ typedef enum {
  * @param message 消息内容 (UTF-8)
  * @param timestamp Unix 时间戳 (秒)
  *
- * @note 此回调在 app_task 上下文中调用，可安全执行 UI/NVS 操作
+ * @note 此回调在 app_task 上下文中调用，可安全执行 UI/NVS 操作。
+ *       sender / message 指向消息缓冲区内部，回调返回后失效，需要保留时请自行拷贝
  */
 typedef void (*ble_message_callback_t)(const char* sender, const char* message, uint32_t timestamp);
 
+/** 单帧最多携带的消息条数 */
+#define BLE_MESSAGE_BATCH_MAX 8
+
+/** 收到的一条消息（字段指向消息缓冲区内部，仅在回调期间有效） */
+typedef struct {
+    const char* sender;    /**< 发送者名称 (UTF-8) */
+    const char* body;      /**< 消息内容 (UTF-8) */
+    uint32_t timestamp;    /**< Unix 时间戳 (秒) */
+} ble_message_t;
+
+/**
+ * @brief 批量消息接收回调函数类型
+ *
+ * 同一帧（TEXT 为 1 条，BATCH 为多条）中的消息一次交付，便于作为一次收件箱操作处理。
+ * 设置后取代 ble_message_callback_t。
+ *
+ * @param msgs 消息数组
+ * @param count 条数 (1 ~ BLE_MESSAGE_BATCH_MAX)
+ *
+ * @note 此回调在 app_task 上下文中调用
+ */
+typedef void (*ble_message_batch_callback_t)(const ble_message_t* msgs, size_t count);
+
 /**
  * @brief 时间同步回调函数类型
  *
@@ -74,11 +98,20 @@ esp_err_t ble_manager_message_queue_init(void);
 /**
  * @brief 处理待处理的 BLE 消息（在应用主循环中调用）
  *
- * 应在主循环中以 >= 50Hz 的频率调用。
+ * 收到 ble_manager_set_pending_callback() 的通知后调用。
  * 每次调用会排空队列中的所有待处理消息，并调用注册的回调函数。
  */
 void ble_manager_process_pending_messages(void);
 
+/**
+ * @brief 设置消息入队通知回调
+ *
+ * 消息入队后在 ble_worker 任务上下文中调用，只应做唤醒 app_task 之类的轻量操作。
+ *
+ * @param callback 回调函数指针
+ */
+void ble_manager_set_pending_callback(void (*callback)(void));
+
 /**
  * @brief 反初始化蓝牙管理器
  *
@@ -107,6 +140,13 @@ esp_err_t ble_manager_stop_advertising(void);
  */
 void ble_manager_set_message_callback(ble_message_callback_t callback);
 
+/**
+ * @brief 设置批量消息接收回调（优先于 ble_manager_set_message_callback()）
+ *
+ * @param callback 回调函数指针
+ */
+void ble_manager_set_message_batch_callback(ble_message_batch_callback_t callback);
+
 /**
  * @brief 设置时间同步回调
  *
@@ -150,6 +190,89 @@ const char* ble_manager_get_device_name(void);
  */
 uint32_t ble_manager_get_error_count(void);
 
+/**
+ * @brief BLE 运行统计
+ *
+ * 蓝牙回调（BTC 任务）只做拷贝和投递，解析、NVS 写入和回复都在 ble_worker 任务中完成；
+ * 回调耗时与命令队列深度用于确认回调没有被阻塞。
+ */
+typedef struct {
+    uint32_t callbacks;          /**< GAP / GATT 回调次数 */
+    uint64_t callback_total_us;  /**< 回调累计耗时 */
+    uint32_t callback_max_us;    /**< 单次回调最长耗时 */
+    uint32_t rx_writes;          /**< 投递给工作任务的 RX 写入数 */
+    uint32_t rx_dropped;         /**< 缓冲池耗尽丢弃的 RX 写入数 */
+    uint32_t msg_dropped;        /**< 消息缓冲区已满被拒绝（已回复 NACK）的消息数 */
+    uint32_t nacks_sent;         /**< 发送的 NACK 数 */
+    uint32_t credit_updates;     /**< 主动下发的额度更新数 */
+    uint32_t ack_frames;         /**< 发出的 ACK / BATCH_ACK 帧数 */
+    uint32_t acked_messages;     /**< 被确认的消息条数（与 ack_frames 之比即合并率） */
+    uint32_t tx_frames;          /**< 发出的完整帧数 */
+    uint32_t tx_notifies;        /**< 发出的通知数（按 MTU 分片后） */
+    uint32_t tx_dropped;         /**< TX 队列已满丢弃的帧数 */
+    uint32_t tx_congestions;     /**< 链路拥塞事件数 */
+    uint32_t conn_fast_ms;       /**< 处于短连接间隔（传输中）的累计时间 */
+    uint32_t conn_idle_ms;       /**< 处于长连接间隔 + 从机延迟（空闲）的累计时间 */
+    uint32_t conn_updates;       /**< 生效的连接参数更新次数 */
+    uint32_t conn_update_failures; /**< 被拒绝或请求失败的连接参数更新次数 */
+    uint32_t adv_fast_ms;        /**< 快速广播档位累计时间 */
+    uint32_t adv_slow_ms;        /**< 慢速广播档位累计时间 */
+    uint32_t adv_background_ms;  /**< 后台广播档位累计时间 */
+    uint32_t adv_data_configs;   /**< 向控制器下发广告数据的次数（数据未变化时复用） */
+    uint32_t reconnects;         /**< 广播后建立连接的次数 */
+    uint32_t reconnect_last_ms;  /**< 最近一次从开始广播到连接的耗时 */
+    uint32_t reconnect_max_ms;   /**< 从开始广播到连接的最长耗时 */
+    uint32_t beacon_updates;     /**< 状态信标（扫描响应）下发次数 */
+    uint32_t connections;        /**< 建立的连接数 */
+    uint32_t idle_connections;   /**< 未收到任何消息就断开的连接数（信标可避免的连接） */
+    uint32_t stranger_connections; /**< 已绑定时非绑定设备建立的连接数（绑定表满且接受列表生效后应为 0） */
+    uint32_t duplicates;         /**< 按序号识别出的重传消息（只确认，未重复入队） */
+    uint32_t frames;             /**< 组装出的完整帧数 */
+    uint32_t resync_bytes;       /**< 重新同步丢弃的字节数 */
+    uint32_t queue_depth;        /**< 当前命令队列深度 */
+    uint32_t queue_high_water;   /**< 命令队列深度峰值 */
+    uint32_t worker_max_us;      /**< 工作任务处理单条命令的最长耗时 */
+} ble_manager_stats_t;
+
+/**
+ * @brief 获取 BLE 运行统计
+ *
+ * @param out 输出
+ */
+void ble_manager_get_stats(ble_manager_stats_t* out);
+
+/**
+ * @brief 刷新扫描响应中的状态信标
+ *
+ * 信标包含未读条数、电量、协议版本与收件箱序号（格式见 bipupu_protocol.h），
+ * 内容未变化时不产生 HCI 操作；变化时直接更新扫描响应，不中断广播。
+ * 收件箱变化或电量可能变化后调用。
+ *
+ * @return esp_err_t ESP_OK 成功，ESP_ERR_INVALID_STATE 协议栈未就绪
+ */
+esp_err_t ble_manager_update_status_beacon(void);
+
+/**
+ * @brief 当前连接协商结果
+ *
+ * 连接后设备请求 2M PHY 与 251 字节链路层数据长度，实际取值由对端决定。
+ */
+typedef struct {
+    uint8_t tx_phy;              /**< 发送 PHY：1 = 1M，2 = 2M，3 = Coded */
+    uint8_t rx_phy;              /**< 接收 PHY */
+    uint16_t tx_data_len;        /**< 链路层发送数据长度（27 表示未启用 DLE） */
+    uint16_t rx_data_len;        /**< 链路层接收数据长度 */
+    uint16_t mtu;                /**< ATT MTU */
+} ble_manager_link_info_t;
+
+/**
+ * @brief 获取当前连接的 PHY、数据长度与 MTU
+ *
+ * @param out 输出
+ * @return esp_err_t ESP_OK 成功，ESP_ERR_INVALID_STATE 未连接
+ */
+esp_err_t ble_manager_get_link_info(ble_manager_link_info_t* out);
+
 /**
  * @brief 轮询蓝牙管理器 (需要在主循环中调用)
  */
@@ -169,6 +292,47 @@ uint16_t ble_manager_get_conn_id(void);
  */
 esp_err_t ble_manager_disconnect(void);
 
+/**
+ * @brief 发送时间同步响应
+ *
+ * @param timestamp Unix 时间戳 (秒)
+ * @return esp_err_t ESP_OK 成功，其他值失败
+ */
+esp_err_t ble_manager_send_time_sync_response(uint32_t timestamp);
+
+/**
+ * 最多同时绑定的手机数量。
+ * 未满时新手机可在慢速 / 后台广播档位连接并绑定（快速档位只接受已绑定手机）；
+ * 表满且全部绑定为固定地址时只接受已绑定手机，需先解绑腾出槽位；
+ * 否则新绑定替换最久未连接的一台。
+ */
+#define BLE_MAX_BONDS 4
+
+/** 绑定名称最大长度（含结尾 0） */
+#define BLE_BOND_NAME_MAX 24
+
+/** 一台已绑定手机的信息 */
+typedef struct {
+    uint8_t addr[6];                /**< 蓝牙地址 */
+    char name[BLE_BOND_NAME_MAX];   /**< 绑定时手机上报的名称，可能为空 */
+    uint32_t last_seen;             /**< 最近连接时间（Unix 秒，设备未同步时间时不准确） */
+    uint32_t msg_count;             /**< 累计收到的消息条数 */
+} ble_bond_info_t;
+
+/**
+ * @brief 获取绑定表
+ *
+ * @param out 输出数组
+ * @param max 数组容量
+ * @return int 写入的条数
+ */
+int ble_manager_get_bonds(ble_bond_info_t* out, int max);
+
+/**
+ * @brief 强制清除全部绑定并断开连接（本地按键解绑）
+ */
+void ble_manager_force_reset_bonds(void);
+
 
 /**
  * @brief 全局连接状态标识（可直接读取）
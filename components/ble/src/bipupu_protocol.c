@@ -58,6 +58,32 @@ static void write_le32(uint8_t* buffer, uint32_t value)
     buffer[3] = (uint8_t)((value >> 24) & 0xFF);
 }
 
+/**
+ * @brief 组装完整数据包（协议头 + 数据 + 校验和）
+ * @return 数据包长度，缓冲区不足时返回 0
+ */
+static size_t build_packet(bipupu_message_type_t type, uint32_t timestamp,
+                           const uint8_t* data, uint16_t data_length,
+                           uint8_t* buffer, size_t buffer_size)
+{
+    size_t packet_length = BIPUPU_HEADER_LENGTH + data_length + BIPUPU_CHECKSUM_LENGTH;
+    if (!buffer || buffer_size < packet_length) {
+        ESP_LOGE(TAG, "缓冲区不足：%zu 字节 (需要 %zu 字节)", buffer_size, packet_length);
+        return 0;
+    }
+
+    buffer[0] = BIPUPU_PROTOCOL_HEADER;
+    write_le32(&buffer[1], timestamp);
+    buffer[5] = (uint8_t)type;
+    write_le16(&buffer[6], data_length);
+    if (data_length > 0) {
+        memcpy(&buffer[BIPUPU_HEADER_LENGTH], data, data_length);
+    }
+    buffer[packet_length - 1] = bipupu_protocol_calculate_checksum(buffer, packet_length - 1);
+
+    return packet_length;
+}
+
 /* ================== 公共接口实现 ================== */
 
 uint8_t bipupu_protocol_calculate_checksum(const uint8_t* data, size_t length)
@@ -260,6 +286,207 @@ bool bipupu_protocol_parse(const uint8_t* data, size_t length, bipupu_parsed_pac
     return true;
 }
 
+/** TEXT 消息未携带发送者时的默认发送者 */
+static const uint8_t s_default_sender[] = "App";
+
+bool bipupu_protocol_parse_view(const uint8_t* data, size_t length, bipupu_packet_view_t* view)
+{
+    if (!data || !view || length < BIPUPU_MIN_PACKET_LENGTH) {
+        ESP_LOGE(TAG, "无效的输入参数");
+        return false;
+    }
+
+    if (!bipupu_protocol_validate_packet(data, length)) {
+        return false;
+    }
+
+    uint8_t calculated_checksum = bipupu_protocol_calculate_checksum(data, length - 1);
+    if (calculated_checksum != data[length - 1]) {
+        ESP_LOGW(TAG, "校验和验证失败：接收 0x%02X, 计算 0x%02X",
+                data[length - 1], calculated_checksum);
+        return false;
+    }
+
+    view->timestamp = read_le32(&data[1]);
+    view->message_type = (bipupu_message_type_t)data[5];
+    view->payload.ptr = &data[BIPUPU_HEADER_LENGTH];
+    view->payload.len = read_le16(&data[6]);
+    view->sender = (bipupu_span_t){ s_default_sender, sizeof(s_default_sender) - 1 };
+    view->body = (bipupu_span_t){ view->payload.ptr, 0 };
+    view->seq = 0;
+    view->has_seq = false;
+
+    // 带序号的帧：取出序号后按普通 TEXT / BATCH 处理
+    if (view->message_type == BIPUPU_MSG_TEXT_SEQ || view->message_type == BIPUPU_MSG_BATCH_SEQ) {
+        if (view->payload.len < 4) {
+            ESP_LOGW(TAG, "带序号的消息过短：%u", view->payload.len);
+            return false;
+        }
+        view->seq = read_le32(view->payload.ptr);
+        view->has_seq = true;
+        view->payload.ptr += 4;
+        view->payload.len -= 4;
+        view->body.ptr = view->payload.ptr;
+        view->message_type = (view->message_type == BIPUPU_MSG_TEXT_SEQ) ? BIPUPU_MSG_TEXT
+                                                                          : BIPUPU_MSG_BATCH;
+    }
+
+    if (view->message_type == BIPUPU_MSG_TEXT && view->payload.len > 0) {
+        const uint8_t* p = view->payload.ptr;
+        uint8_t sender_len = p[0];
+
+        // 与 bipupu_parsed_packet_t.sender_name[65] 的限制保持一致
+        bool sender_valid = (sender_len > 0)
+            && ((size_t)(1 + sender_len) <= view->payload.len)
+            && (sender_len < 65);
+
+        if (sender_valid) {
+            view->sender = (bipupu_span_t){ &p[1], sender_len };
+        }
+
+        uint16_t body_offset = sender_valid ? (uint16_t)(1 + sender_len) : 1;
+        view->body.ptr = &p[body_offset];
+        view->body.len = view->payload.len > body_offset
+                             ? (uint16_t)(view->payload.len - body_offset) : 0;
+    }
+
+    ESP_LOGD(TAG, "解析数据包视图：类型=0x%02X, 时间戳=%u, 数据长度=%u",
+            view->message_type, view->timestamp, view->payload.len);
+
+    return true;
+}
+
+/**
+ * @brief 读取 LEB128 变长整数
+ * @return 消耗的字节数，数据不完整或超过 32 位时返回 0
+ */
+static size_t read_varint(const uint8_t* p, const uint8_t* end, uint32_t* out)
+{
+    uint32_t value = 0;
+    for (size_t i = 0; i < 5 && p + i < end; i++) {
+        value |= (uint32_t)(p[i] & 0x7F) << (7 * i);
+        if (!(p[i] & 0x80)) {
+            *out = value;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+int bipupu_protocol_parse_batch(const bipupu_packet_view_t* view, bipupu_batch_record_t* records)
+{
+    if (!view || !records || view->message_type != BIPUPU_MSG_BATCH || view->payload.len < 1) {
+        return -1;
+    }
+
+    const uint8_t* p = view->payload.ptr;
+    const uint8_t* end = p + view->payload.len;
+    uint8_t count = *p++;
+    if (count == 0 || count > BIPUPU_BATCH_MAX_RECORDS) {
+        ESP_LOGW(TAG, "批量消息条数非法：%u", count);
+        return -1;
+    }
+
+    bipupu_span_t sender = { s_default_sender, sizeof(s_default_sender) - 1 };
+    for (uint8_t i = 0; i < count; i++) {
+        uint32_t offset;
+        size_t n = read_varint(p, end, &offset);
+        if (n == 0 || end - (p + n) < 2) {
+            break;
+        }
+        p += n;
+        uint8_t sender_len = p[0];
+        uint8_t body_len = p[1];
+        p += 2;
+
+        if (sender_len == BIPUPU_BATCH_SAME_SENDER) {
+            if (i == 0) {
+                break;
+            }
+        } else if (sender_len >= 65) {
+            break;
+        } else if (sender_len == 0) {
+            sender = (bipupu_span_t){ s_default_sender, sizeof(s_default_sender) - 1 };
+        } else {
+            if (end - p < sender_len) {
+                break;
+            }
+            sender = (bipupu_span_t){ p, sender_len };
+            p += sender_len;
+        }
+
+        if (end - p < body_len) {
+            break;
+        }
+        records[i].timestamp = view->timestamp + offset;
+        records[i].sender = sender;
+        records[i].body = (bipupu_span_t){ p, body_len };
+        p += body_len;
+
+        if (i == count - 1) {
+            if (p != end) {
+                break;
+            }
+            return count;
+        }
+    }
+
+    ESP_LOGW(TAG, "批量消息格式错误");
+    return -1;
+}
+
+size_t bipupu_protocol_copy_utf8(const uint8_t* data, size_t length, char* output, size_t output_size)
+{
+    if (!output || output_size == 0) {
+        return 0;
+    }
+
+    size_t i = 0, j = 0;
+    const size_t max_output_len = output_size - 1;
+
+    while (data && i < length) {
+        uint8_t first_byte = data[i];
+        size_t seq_len;
+
+        if ((first_byte & 0x80) == 0x00) {
+            if (j >= max_output_len) {
+                break;
+            }
+            output[j++] = (char)first_byte;
+            i++;
+            continue;
+        } else if ((first_byte & 0xE0) == 0xC0) {
+            seq_len = 2;
+        } else if ((first_byte & 0xF0) == 0xE0) {
+            seq_len = 3;
+        } else if ((first_byte & 0xF8) == 0xF0) {
+            seq_len = 4;
+        } else {
+            seq_len = 0;
+        }
+
+        if (seq_len == 0 || i + seq_len > length) {
+            // 非法首字节或不完整序列，替换为 '?'
+            if (j + 1 > max_output_len) {
+                break;
+            }
+            output[j++] = '?';
+            i++;
+            continue;
+        }
+
+        if (j + seq_len > max_output_len) {
+            break;
+        }
+        for (size_t k = 0; k < seq_len; k++) {
+            output[j++] = (char)data[i++];
+        }
+    }
+
+    output[j] = '\0';
+    return j;
+}
+
 size_t bipupu_protocol_create_time_sync(uint32_t timestamp, uint8_t* buffer, size_t buffer_size)
 {
     if (!buffer || buffer_size < BIPUPU_MIN_PACKET_LENGTH) {
@@ -377,3 +604,194 @@ size_t bipupu_protocol_create_acknowledgement(uint32_t original_message_id, uint
     
     return packet_length;
 }
+
+size_t bipupu_protocol_create_ack_with_credits(uint32_t original_message_id, uint8_t credits,
+                                               uint8_t* buffer, size_t buffer_size)
+{
+    uint8_t data[5];
+    write_le32(data, original_message_id);
+    data[4] = credits;
+
+    size_t packet_length = build_packet(BIPUPU_MSG_ACKNOWLEDGEMENT, original_message_id,
+                                        data, sizeof(data), buffer, buffer_size);
+    ESP_LOGD(TAG, "创建 ACK 数据包：msg_id=%u, 额度=%u", original_message_id, credits);
+    return packet_length;
+}
+
+size_t bipupu_protocol_create_nack(uint32_t original_message_id, bipupu_nack_reason_t reason,
+                                   uint8_t credits, uint8_t* buffer, size_t buffer_size)
+{
+    uint8_t data[6];
+    write_le32(data, original_message_id);
+    data[4] = (uint8_t)reason;
+    data[5] = credits;
+
+    size_t packet_length = build_packet(BIPUPU_MSG_NACK, original_message_id,
+                                        data, sizeof(data), buffer, buffer_size);
+    ESP_LOGD(TAG, "创建 NACK 数据包：msg_id=%u, 原因=%u, 额度=%u",
+            original_message_id, reason, credits);
+    return packet_length;
+}
+
+size_t bipupu_protocol_create_credit(uint8_t credits, uint8_t* buffer, size_t buffer_size)
+{
+    return build_packet(BIPUPU_MSG_CREDIT, 0, &credits, 1, buffer, buffer_size);
+}
+
+size_t bipupu_protocol_create_batch_ack(const uint32_t* message_ids, uint8_t count, uint8_t credits,
+                                        uint8_t* buffer, size_t buffer_size)
+{
+    if (!message_ids || count == 0 || count > BIPUPU_BATCH_ACK_MAX) {
+        ESP_LOGE(TAG, "无效参数");
+        return 0;
+    }
+
+    uint8_t data[2 + 4 * BIPUPU_BATCH_ACK_MAX];
+    data[0] = credits;
+    data[1] = count;
+    for (uint8_t i = 0; i < count; i++) {
+        write_le32(&data[2 + 4 * i], message_ids[i]);
+    }
+
+    return build_packet(BIPUPU_MSG_BATCH_ACK, message_ids[count - 1],
+                        data, (uint16_t)(2 + 4 * count), buffer, buffer_size);
+}
+
+size_t bipupu_protocol_create_hello(uint8_t version, uint8_t features, uint8_t credits,
+                                    uint8_t* buffer, size_t buffer_size)
+{
+    uint8_t data[3] = { version, features, credits };
+    return build_packet(BIPUPU_MSG_HELLO, 0, data, sizeof(data), buffer, buffer_size);
+}
+
+/* ================== 流式帧组装 ================== */
+
+_Static_assert((BIPUPU_ASSEMBLER_RING_SIZE & (BIPUPU_ASSEMBLER_RING_SIZE - 1)) == 0,
+               "组装缓冲区大小必须是 2 的幂");
+_Static_assert(BIPUPU_ASSEMBLER_RING_SIZE > BIPUPU_MAX_PACKET_LENGTH,
+               "组装缓冲区必须能容纳一个完整帧");
+
+#define RING_MASK (BIPUPU_ASSEMBLER_RING_SIZE - 1)
+
+static inline uint8_t ring_peek(const bipupu_assembler_t* as, size_t offset)
+{
+    return as->ring[(as->head + offset) & RING_MASK];
+}
+
+static void ring_copy_out(const bipupu_assembler_t* as, uint8_t* dst, size_t n)
+{
+    size_t first = BIPUPU_ASSEMBLER_RING_SIZE - as->head;
+    if (first > n) {
+        first = n;
+    }
+    memcpy(dst, &as->ring[as->head], first);
+    memcpy(dst + first, as->ring, n - first);
+}
+
+static void ring_drop(bipupu_assembler_t* as, size_t n)
+{
+    as->head = (uint16_t)((as->head + n) & RING_MASK);
+    as->count = (uint16_t)(as->count - n);
+}
+
+/**
+ * @brief 从环形缓冲区切出所有完整帧，剩余不完整的帧保留到下次写入
+ */
+static size_t assembler_drain(bipupu_assembler_t* as, bipupu_frame_handler_t handler, void* ctx)
+{
+    size_t delivered = 0;
+
+    while (as->count > 0) {
+        // 重新同步：跳到下一个协议头
+        if (ring_peek(as, 0) != BIPUPU_PROTOCOL_HEADER) {
+            size_t skip = 1;
+            while (skip < as->count && ring_peek(as, skip) != BIPUPU_PROTOCOL_HEADER) {
+                skip++;
+            }
+            ring_drop(as, skip);
+            as->discarded_bytes += skip;
+            continue;
+        }
+
+        if (as->count < BIPUPU_HEADER_LENGTH) {
+            break;
+        }
+
+        ring_copy_out(as, as->frame, BIPUPU_HEADER_LENGTH);
+        size_t total = bipupu_protocol_get_packet_length(as->frame, BIPUPU_HEADER_LENGTH);
+        if (total > BIPUPU_MAX_PACKET_LENGTH) {
+            // 长度字段不可能合法，说明 0xB0 只是数据中的普通字节
+            ring_drop(as, 1);
+            as->discarded_bytes++;
+            continue;
+        }
+
+        if (as->count < total) {
+            break;
+        }
+
+        ring_copy_out(as, as->frame, total);
+        if (bipupu_protocol_calculate_checksum(as->frame, total - 1) != as->frame[total - 1]) {
+            ring_drop(as, 1);
+            as->discarded_bytes++;
+            continue;
+        }
+
+        ring_drop(as, total);
+        as->frames++;
+        delivered++;
+        if (handler) {
+            handler(as->frame, total, ctx);
+        }
+    }
+
+    return delivered;
+}
+
+void bipupu_assembler_reset(bipupu_assembler_t* as)
+{
+    if (!as) {
+        return;
+    }
+    as->head = 0;
+    as->count = 0;
+}
+
+size_t bipupu_assembler_feed(bipupu_assembler_t* as, const uint8_t* data, size_t length,
+                             bipupu_frame_handler_t handler, void* ctx)
+{
+    if (!as || !data) {
+        return 0;
+    }
+
+    uint32_t discarded_before = as->discarded_bytes;
+    size_t delivered = 0;
+
+    while (length > 0) {
+        // drain 之后缓冲区中最多剩一个不完整的帧，因此每轮至少能写入一部分
+        size_t n = BIPUPU_ASSEMBLER_RING_SIZE - as->count;
+        if (n > length) {
+            n = length;
+        }
+
+        size_t tail = (as->head + as->count) & RING_MASK;
+        size_t first = BIPUPU_ASSEMBLER_RING_SIZE - tail;
+        if (first > n) {
+            first = n;
+        }
+        memcpy(&as->ring[tail], data, first);
+        memcpy(as->ring, data + first, n - first);
+        as->count = (uint16_t)(as->count + n);
+        data += n;
+        length -= n;
+
+        delivered += assembler_drain(as, handler, ctx);
+    }
+
+    if (as->discarded_bytes != discarded_before) {
+        ESP_LOGW(TAG, "重新同步：丢弃 %u 字节",
+                (unsigned)(as->discarded_bytes - discarded_before));
+    }
+
+    return delivered;
+}
@@ -28,6 +28,9 @@ esp_err_t board_init(void) {
   // 各模块初始化
   // 注意：部分模块可能依赖 I2C 或其他基础配置，需注意初始化顺序
 
+  // 0. 电源管理（DFS + 自动 Light Sleep），需先于使用 PM 锁的外设
+  board_pm_init();
+
   // 1. 基础总线初始化（若已由 main.c 提前完成则此处为幂等跳过）
   bool i2c_was_new = (board_i2c_bus_handle == NULL);
   board_i2c_init();
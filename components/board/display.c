@@ -13,6 +13,21 @@ static u8g2_t s_u8g2;
 static i2c_master_dev_handle_t display_dev_handle = NULL;
 static bool s_display_initialized = false;
 static SemaphoreHandle_t s_display_mutex = NULL;
+static bool s_power_save = false;
+
+/* ================== 脏块局部刷新 ==================
+ * SSD1309 显存按 8 像素高的 page 组织，u8g2 全缓冲模式下每个 tile 为 8x8 像素（8 字节）。
+ * 保存上一次真正发送到屏幕的帧作为影子缓冲，逐 page 比较 tile，只发送变化的 tile 区间，
+ * 避免每帧都通过 400kHz I2C 推送完整的 1KB 帧。 */
+#define DISPLAY_TILE_COLS   16
+#define DISPLAY_TILE_ROWS   8
+#define DISPLAY_TILE_BYTES  8
+#define DISPLAY_BUF_SIZE    (DISPLAY_TILE_COLS * DISPLAY_TILE_ROWS * DISPLAY_TILE_BYTES)
+
+static uint8_t s_shadow_buf[DISPLAY_BUF_SIZE];
+static bool s_shadow_valid = false;     /* false 时下一帧整屏发送（初始化/I2C 出错后） */
+static uint32_t s_frame_tx_bytes = 0;   /* 当前帧经 I2C 发出的字节数（含命令） */
+static board_display_stats_t s_stats = {0};
 
 /* 预刷新钩子：在 SendBuffer 之前调用，用于叠加 Toast/HUD 层 */
 static void (*s_pre_flush_cb)(void) = NULL;
@@ -73,6 +88,7 @@ static uint8_t u8g2_esp32_i2c_byte_cb(u8x8_t *u8x8, uint8_t msg,
 
         // 一次性传输整个缓冲区数据
         esp_err_t ret = i2c_master_transmit(display_dev_handle, buffer, buf_idx, pdMS_TO_TICKS(200));
+        s_frame_tx_bytes += buf_idx;
         
         if (ret != ESP_OK) {
             ESP_LOGE(BOARD_TAG, "I2C传输失败: %s (数据长度: %zu)", esp_err_to_name(ret), buf_idx);
@@ -87,6 +103,8 @@ static uint8_t u8g2_esp32_i2c_byte_cb(u8x8_t *u8x8, uint8_t msg,
                 ret = i2c_master_transmit(display_dev_handle, buffer, buf_idx, pdMS_TO_TICKS(200));
                 if (ret != ESP_OK) {
                     ESP_LOGE(BOARD_TAG, "I2C总线重置后传输仍然失败: %s", esp_err_to_name(ret));
+                    // 屏幕内容已与影子缓冲不一致，下一帧整屏重发
+                    s_shadow_valid = false;
                 }
             }
         }
@@ -175,11 +193,71 @@ void board_display_init(void) {
     u8g2_SetPowerSave(&s_u8g2, 0);
     u8g2_ClearBuffer(&s_u8g2);
     u8g2_SendBuffer(&s_u8g2);
+    memset(s_shadow_buf, 0, sizeof(s_shadow_buf));
+    s_shadow_valid = true;
     
     s_display_initialized = true;
     ESP_LOGI(BOARD_TAG, "Display initialized successfully");
 }
 
+/* 比较帧缓冲与影子缓冲，按 page 发送变化 tile 所覆盖的最小列区间 */
+static void display_flush_dirty(void) {
+    uint8_t *buf = u8g2_GetBufferPtr(&s_u8g2);
+    s_frame_tx_bytes = 0;
+    uint32_t dirty_tiles = 0;
+
+    if (!s_shadow_valid) {
+        s_shadow_valid = true;  // 发送失败时由 I2C 回调重新置为 false
+        u8g2_SendBuffer(&s_u8g2);
+        memcpy(s_shadow_buf, buf, sizeof(s_shadow_buf));
+        dirty_tiles = DISPLAY_TILE_COLS * DISPLAY_TILE_ROWS;
+        s_stats.full_frames++;
+    } else {
+        for (int ty = 0; ty < DISPLAY_TILE_ROWS; ty++) {
+            int row_off = ty * DISPLAY_TILE_COLS * DISPLAY_TILE_BYTES;
+            int first = -1;
+            int last = -1;
+            for (int tx = 0; tx < DISPLAY_TILE_COLS; tx++) {
+                int off = row_off + tx * DISPLAY_TILE_BYTES;
+                if (memcmp(&buf[off], &s_shadow_buf[off], DISPLAY_TILE_BYTES) != 0) {
+                    if (first < 0) first = tx;
+                    last = tx;
+                    dirty_tiles++;
+                }
+            }
+            if (first < 0) continue;
+
+            int span = last - first + 1;
+            u8g2_UpdateDisplayArea(&s_u8g2, (uint8_t)first, (uint8_t)ty, (uint8_t)span, 1);
+            int span_off = row_off + first * DISPLAY_TILE_BYTES;
+            memcpy(&s_shadow_buf[span_off], &buf[span_off], (size_t)span * DISPLAY_TILE_BYTES);
+        }
+        if (dirty_tiles == 0) {
+            s_stats.skipped_frames++;
+        }
+    }
+
+    s_stats.frames++;
+    s_stats.last_frame_bytes = s_frame_tx_bytes;
+    s_stats.last_frame_tiles = dirty_tiles;
+    s_stats.total_bytes += s_frame_tx_bytes;
+    ESP_LOGD(BOARD_TAG, "Display flush: %lu tiles, %lu bytes",
+             (unsigned long)dirty_tiles, (unsigned long)s_frame_tx_bytes);
+}
+
+void board_display_get_stats(board_display_stats_t *out) {
+    if (out == NULL) return;
+    if (!display_lock()) return;
+    *out = s_stats;
+    display_unlock();
+}
+
+void board_display_reset_stats(void) {
+    if (!display_lock()) return;
+    memset(&s_stats, 0, sizeof(s_stats));
+    display_unlock();
+}
+
 /* ================== 显示接口实现 ================== */
 void board_display_begin(void) {
     if (!s_display_initialized) {
@@ -204,7 +282,10 @@ void board_display_end(void) {
     if (s_pre_flush_cb) {
         s_pre_flush_cb();
     }
-    u8g2_SendBuffer(&s_u8g2);
+    // 整帧 I2C 传输期间保持 APB 满频，避免事务之间进入 Light Sleep 或切换频率
+    board_pm_acquire(BOARD_PM_LOCK_DISPLAY);
+    display_flush_dirty();
+    board_pm_release(BOARD_PM_LOCK_DISPLAY);
     display_unlock();
 }
 
@@ -245,6 +326,12 @@ int board_display_text_width(const char* text) {
   return (int)u8g2_GetUTF8Width(&s_u8g2, (char*)text);
 }
 
+int board_display_glyph_width(uint16_t encoding) {
+  if (!s_display_initialized) return 0;
+  // 返回字形步进宽度 (dx)，字体中不存在的字形返回 0
+  return (int)u8g2_GetGlyphWidth(&s_u8g2, encoding);
+}
+
 void board_display_set_contrast(uint8_t contrast) {
   if (!s_display_initialized) {
     ESP_LOGW(BOARD_TAG, "Cannot set contrast: display not initialized");
@@ -275,6 +362,25 @@ void board_display_set_font_mode(uint8_t mode) {
   u8g2_SetFontMode(&s_u8g2, mode);
 }
 
+void board_display_set_power_save(bool enable) {
+  if (!s_display_initialized) return;
+  if (!display_lock()) {
+    ESP_LOGW(BOARD_TAG, "Failed to lock display for power save");
+    return;
+  }
+  if (s_power_save != enable) {
+    // SSD1309 Display OFF/ON 命令：关闭时面板停止驱动，显存内容保留
+    u8g2_SetPowerSave(&s_u8g2, enable ? 1 : 0);
+    s_power_save = enable;
+    ESP_LOGD(BOARD_TAG, "Display power save %s", enable ? "on" : "off");
+  }
+  display_unlock();
+}
+
+bool board_display_is_power_save(void) {
+  return s_power_save;
+}
+
 /* 检查显示是否已初始化 */
 bool board_display_is_initialized(void) {
     return s_display_initialized;
@@ -48,6 +48,9 @@ typedef enum {
 
 /* ================== 核心生命周期 ================== */
 
+/* *_tick() 返回值：无待推进的动画，调用方可无限期阻塞直到事件回调 */
+#define BOARD_TICK_IDLE UINT32_MAX
+
 uint32_t  board_time_ms(void);
 void      board_delay_ms(uint32_t ms);
 
@@ -72,9 +75,12 @@ void board_display_rect(int x, int y, int w, int h, bool fill);
 void board_display_glyph(int x, int y, uint16_t encoding);
 void board_display_set_font(const void* font);
 int board_display_text_width(const char* text);
+int board_display_glyph_width(uint16_t encoding);   // 单个字形的步进宽度（用于增量排版）
 void board_display_set_contrast(uint8_t contrast);  // OLED亮度/对比度控制
 void board_display_set_draw_color(uint8_t color);   // 0=黑 1=白 2=XOR
 void board_display_set_font_mode(uint8_t mode);     // 0=实心 1=透明
+void board_display_set_power_save(bool enable);     // true=关闭面板（显存保留），false=恢复显示
+bool board_display_is_power_save(void);
 /**
  * @brief 注册预刷新钩子（在 board_display_end → SendBuffer 之前调用）
  * 用于在任意页面渲染帧的顶层叠加 Toast / HUD，无需修改各页面 render 函数。
@@ -83,12 +89,25 @@ void board_display_set_font_mode(uint8_t mode);     // 0=实心 1=透明
  */
 void board_display_set_pre_flush_cb(void (*cb)(void));
 
+/** 显示刷新统计（用于评估局部刷新对 I2C 流量的削减） */
+typedef struct {
+    uint32_t frames;            // board_display_end 调用次数
+    uint32_t full_frames;       // 整屏发送次数（初始化 / I2C 错误恢复）
+    uint32_t skipped_frames;    // 内容无变化、未产生 I2C 数据传输的帧数
+    uint32_t last_frame_tiles;  // 上一帧发送的脏 tile 数（整屏 = 128）
+    uint32_t last_frame_bytes;  // 上一帧经 I2C 发送的字节数（含寻址命令）
+    uint64_t total_bytes;       // 累计发送字节数
+} board_display_stats_t;
+void board_display_get_stats(board_display_stats_t* out);
+void board_display_reset_stats(void);
+
 // 震动接口 (统一为异步非阻塞风格)
 void board_vibrate_short(void);
 void board_vibrate_double(void);
 void board_vibrate_pattern(const uint32_t* ms_array, uint8_t count);
 void board_vibrate_off(void);
-void board_vibrate_tick(void); // 必须在 main loop 调用
+uint32_t board_vibrate_tick(void); // 推进震动模式，返回距下一步的 ms（BOARD_TICK_IDLE=空闲）
+void board_vibrate_set_event_cb(void (*cb)(void)); // 新模式启动时回调，用于唤醒调用 tick 的任务
 void board_vibrate_test_direct(uint32_t duration_ms); // 测试用：直接GPIO输出
 
 /* ================== RTC (实时时钟) 接口 ================== */
@@ -129,6 +148,32 @@ void board_notify(void);
 /* ================== 电源管理接口 ================== */
 /* 低电压保护功能已弃用。电压读取请使用 board_battery_voltage() / board_battery_percent()。 */
 
+/** PM 锁：持有期间禁止自动 Light Sleep（并保持对应时钟满频） */
+typedef enum {
+    BOARD_PM_LOCK_DISPLAY = 0,  // I2C 刷屏
+    BOARD_PM_LOCK_ADC,          // 电池电压采样
+    BOARD_PM_LOCK_VIBRATE,      // LEDC 震动 PWM 输出期间
+    BOARD_PM_LOCK_BLE,          // BLE 连接建立阶段
+    BOARD_PM_LOCK_COUNT
+} board_pm_lock_id_t;
+
+/** PM 锁持有统计（用于评估各外设阻止休眠的时长） */
+typedef struct {
+    bool     enabled;           // CONFIG_PM_ENABLE 是否生效
+    uint64_t uptime_us;         // 统计快照时刻
+    uint64_t any_held_us;       // 任一锁被持有的累计时长（芯片被强制唤醒的时间）
+    struct {
+        uint32_t acquire_count; // 0→1 获取次数
+        uint64_t held_us;       // 累计持有时长
+    } locks[BOARD_PM_LOCK_COUNT];
+} board_pm_stats_t;
+
+esp_err_t   board_pm_init(void);                       // 配置 DFS + 自动 Light Sleep 并创建锁
+void        board_pm_acquire(board_pm_lock_id_t id);   // 支持嵌套，须与 release 成对调用
+void        board_pm_release(board_pm_lock_id_t id);
+void        board_pm_get_stats(board_pm_stats_t* out);
+const char* board_pm_lock_name(board_pm_lock_id_t id);
+
 
 /* ================== 三个独立白光 LED 接口（双层状态机 v2）================== */
 /*
@@ -138,7 +183,8 @@ void board_notify(void);
  *   BACKGROUND → 持久背景（跑马/慢闪/常灭），由 board_leds_set_mode() 设置
  */
 void board_leds_init(void);
-void board_leds_tick(void);                    /* 主循环每 10ms 调用 */
+uint32_t board_leds_tick(void);                /* 推进动画，返回距下一步的 ms（BOARD_TICK_IDLE=静态） */
+void board_leds_set_event_cb(void (*cb)(void)); /* 效果变更时回调，用于唤醒调用 tick 的任务 */
 void board_leds_set_mode(board_led_mode_t mode);
 void board_leds_flashlight_on(void);
 void board_leds_flashlight_off(void);
@@ -161,6 +207,17 @@ board_key_t board_key_poll(void);
 bool        board_key_is_pressed(board_key_t key);      // 检查按键是否正被按下
 bool        board_key_is_long_pressed(board_key_t key); // 检查是否长按中
 uint32_t    board_key_press_duration(board_key_t key); // 获取按下持续时间(ms)
+void        board_key_set_event_cb(void (*cb)(void));   // 按键事件入队后回调（esp_timer 任务上下文），用于唤醒消费者
+
+/** 按键延迟统计：触发沿（按下沿/松开沿/长按阈值）到 board_key_poll() 取走事件的时间 */
+typedef struct {
+    uint32_t events;            // 已取走的按键事件数
+    uint32_t wakeups;           // 按键中断次数（每次会启动一轮扫描）
+    uint32_t last_latency_us;
+    uint32_t max_latency_us;
+    uint64_t total_latency_us;
+} board_key_stats_t;
+void        board_key_get_stats(board_key_stats_t* out);
 float       board_battery_voltage(void);
 uint8_t     board_battery_percent(void);
 bool        board_battery_is_charging(void);
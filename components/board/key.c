@@ -1,41 +1,62 @@
 /**
  * @file key.c
- * @brief 按键驱动 - 轮询模式（10ms周期）
+ * @brief 按键驱动 - GPIO 中断唤醒 + 按需扫描
  *
- * 采用软件轮询代替GPIO中断，避免多按钮间的中断优先级竞争
- * 去抖动：50ms
+ * 空闲时不运行任何定时器：四个按键配置为低电平中断，同时作为 Light Sleep 唤醒源。
+ * 中断触发后关闭该引脚中断并启动 10ms 扫描定时器，完成去抖 / 短按 / 长按判定；
+ * 所有按键松开且去抖屏蔽期结束后停止扫描、重新使能中断。
+ *
+ * 去抖：按下沿由中断时间戳记录，下一次扫描仍为按下即确认（滤除单周期毛刺）；
+ *       松开需连续 2 次扫描确认，之后 50ms 内忽略抖动
  * 长按检测：800ms
- * 轮询周期：10ms
+ * 扫描周期：10ms（仅按键活动期间）
  */
 
 #include "board_pins.h"
 #include "board.h"
 #include "driver/gpio.h"
+#include "esp_attr.h"
 #include "esp_log.h"
+#include "esp_sleep.h"
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include <string.h>
 
 #define BUTTON_COUNT 4
-#define DEBOUNCE_TIME_MS 50
+#define DEBOUNCE_TIME_MS 50        /* 松开后的抖动屏蔽时间 */
 #define LONG_PRESS_MS 800
 #define KEY_QUEUE_SIZE 16
-#define KEY_POLL_INTERVAL_MS 10  /* 轮询周期 */
+#define KEY_SCAN_INTERVAL_MS 10    /* 扫描周期（仅按键活动期间运行） */
+#define KEY_RELEASE_CONFIRM_SCANS 2
 
 typedef struct {
     bool is_pressed;
     uint32_t press_start_time;
     bool long_press_fired;
-    bool debounce_active;
-    uint32_t debounce_start_time;
+    volatile bool pending_press;   /* 中断已检测到按下沿，等待扫描确认 */
+    volatile int64_t press_edge_us;/* 按下沿时间（中断时间戳） */
+    int64_t release_edge_us;       /* 首次扫描到松开的时间 */
+    uint8_t release_count;         /* 连续检测到松开的扫描次数 */
+    uint32_t lockout_until;        /* 松开后抖动屏蔽截止时间 */
 } button_state_t;
 
+/* 队列元素：附带触发沿时间，用于统计按键到消费者的延迟 */
+typedef struct {
+    board_key_t key;
+    int64_t edge_us;
+} key_event_t;
+
 static button_state_t s_button_states[BUTTON_COUNT];
 static bool s_keys_initialized = false;
 static QueueHandle_t s_key_queue = NULL;
 static SemaphoreHandle_t s_key_mutex = NULL;
-static esp_timer_handle_t s_poll_timer = NULL;  /* 轮询定时器 */
+static esp_timer_handle_t s_scan_timer = NULL;  /* 按需扫描定时器 */
+static volatile bool s_scan_active = false;
+static portMUX_TYPE s_scan_mux = portMUX_INITIALIZER_UNLOCKED;
+static void (*s_event_cb)(void) = NULL;
+static board_key_stats_t s_key_stats = {0};
 
 static const gpio_num_t s_button_gpios[BUTTON_COUNT] = {
     BOARD_GPIO_KEY_UP,
@@ -52,66 +73,117 @@ static const board_key_t s_long_map[BUTTON_COUNT] = {
     BOARD_KEY_UP_LONG, BOARD_KEY_DOWN_LONG, BOARD_KEY_ENTER_LONG, BOARD_KEY_BACK_LONG
 };
 
-/* 按键状态处理 - 包含完整的去抖和状态机 */
-static void process_button_state(int button, bool is_pressed, uint32_t timestamp)
+/* 启动扫描定时器（中断与任务上下文均可调用） */
+static void IRAM_ATTR key_scan_start(void)
 {
-    if (button < 0 || button >= BUTTON_COUNT) return;
+    portENTER_CRITICAL_SAFE(&s_scan_mux);
+    if (!s_scan_active) {
+        s_scan_active = true;
+        esp_timer_start_periodic(s_scan_timer, KEY_SCAN_INTERVAL_MS * 1000);
+    }
+    portEXIT_CRITICAL_SAFE(&s_scan_mux);
+}
 
+/* 按键中断：记录按下沿时间，屏蔽本引脚电平中断，交给扫描定时器处理 */
+static void IRAM_ATTR key_isr_handler(void* arg)
+{
+    int button = (int)(intptr_t)arg;
+    gpio_intr_disable(s_button_gpios[button]);
+    s_button_states[button].press_edge_us = esp_timer_get_time();
+    s_button_states[button].pending_press = true;
+    s_key_stats.wakeups++;
+    key_scan_start();
+}
+
+static void emit_key(board_key_t key, int64_t edge_us)
+{
+    key_event_t evt = { .key = key, .edge_us = edge_us };
+    if (xQueueSend(s_key_queue, &evt, 0) != pdTRUE) {
+        ESP_LOGW(BOARD_TAG, "Key queue full, dropping key %d", key);
+        return;
+    }
+    if (s_event_cb != NULL) {
+        s_event_cb();
+    }
+}
+
+/**
+ * 按键状态处理 - 去抖和短按/长按状态机
+ * @return true 表示该按键仍需继续扫描
+ */
+static bool process_button_state(int button, bool is_pressed, uint32_t timestamp, int64_t now_us)
+{
     button_state_t* state = &s_button_states[button];
-    board_key_t key = BOARD_KEY_NONE;
-
-    if (is_pressed && !state->is_pressed) {
-        // 按下过程中的去抖
-        if (!state->debounce_active) {
-            state->debounce_active = true;
-            state->debounce_start_time = timestamp;
-        } else if (timestamp - state->debounce_start_time >= DEBOUNCE_TIME_MS) {
-            // 去抖完成，确认按下
-            state->is_pressed = true;
-            state->press_start_time = timestamp;
-            state->long_press_fired = false;
-            state->debounce_active = false;
+
+    if (!state->is_pressed) {
+        if (state->pending_press) {
+            state->pending_press = false;
+            // 中断后的第一次扫描仍为按下 → 确认，按下时间取中断时间戳
+            if (is_pressed && (int32_t)(state->lockout_until - timestamp) <= 0) {
+                state->is_pressed = true;
+                state->press_start_time = (uint32_t)(state->press_edge_us / 1000);
+                state->long_press_fired = false;
+                state->release_count = 0;
+            }
+        }
+        if (!state->is_pressed) {
+            return (int32_t)(state->lockout_until - timestamp) > 0;
         }
-    } else if (!is_pressed && state->is_pressed) {
-        // 释放过程中的去抖
-        if (!state->debounce_active) {
-            state->debounce_active = true;
-            state->debounce_start_time = timestamp;
-        } else if (timestamp - state->debounce_start_time >= DEBOUNCE_TIME_MS) {
-            // 去抖完成，确认释放
+    }
+
+    if (!is_pressed) {
+        if (state->release_count++ == 0) {
+            state->release_edge_us = now_us;
+        }
+        if (state->release_count >= KEY_RELEASE_CONFIRM_SCANS) {
+            // 松开确认：未触发长按则是短按
             uint32_t duration = timestamp - state->press_start_time;
-            // 如果还没有触发长按，则是短按
             if (!state->long_press_fired && duration < LONG_PRESS_MS) {
-                key = s_short_map[button];
+                emit_key(s_short_map[button], state->release_edge_us);
             }
             state->is_pressed = false;
             state->long_press_fired = false;
-            state->debounce_active = false;
+            state->release_count = 0;
+            state->lockout_until = timestamp + DEBOUNCE_TIME_MS;
+            return true;
         }
+    } else {
+        state->release_count = 0;
     }
 
     /* 长按检测 - 仅触发一次 */
-    if (state->is_pressed && !state->long_press_fired) {
-        if (timestamp - state->press_start_time >= LONG_PRESS_MS) {
-            state->long_press_fired = true;
-            key = s_long_map[button];
-        }
-    }
-
-    if (key != BOARD_KEY_NONE) {
-        xQueueSendFromISR(s_key_queue, &key, NULL);
+    if (!state->long_press_fired && timestamp - state->press_start_time >= LONG_PRESS_MS) {
+        state->long_press_fired = true;
+        emit_key(s_long_map[button], state->press_edge_us + (int64_t)LONG_PRESS_MS * 1000);
     }
+    return true;
 }
 
-/* 轮询定时器回调 - 扫描所有按钮状态 */
-static void key_poll_timer_callback(void* arg)
+/* 扫描定时器回调 - 所有按键空闲后自停并恢复中断 */
+static void key_scan_timer_callback(void* arg)
 {
-    uint32_t now = board_time_ms();
-    
-    /* 逐个扫描所有按钮（不会相互干扰） */
+    (void)arg;
+    int64_t now_us = esp_timer_get_time();
+    uint32_t now = (uint32_t)(now_us / 1000);
+    bool busy = false;
+
     for (int i = 0; i < BUTTON_COUNT; i++) {
         bool raw_state = (gpio_get_level(s_button_gpios[i]) == 0);  /* 低电平为按下 */
-        process_button_state(i, raw_state, now);
+        busy |= process_button_state(i, raw_state, now, now_us);
+    }
+    for (int i = 0; i < BUTTON_COUNT; i++) {
+        busy |= s_button_states[i].pending_press;
+    }
+
+    if (!busy) {
+        portENTER_CRITICAL(&s_scan_mux);
+        esp_timer_stop(s_scan_timer);
+        s_scan_active = false;
+        portEXIT_CRITICAL(&s_scan_mux);
+        // 电平中断：若此时仍有按键按下会立即再次触发
+        for (int i = 0; i < BUTTON_COUNT; i++) {
+            gpio_intr_enable(s_button_gpios[i]);
+        }
     }
 }
 
@@ -128,7 +200,7 @@ void board_key_init(void)
     }
 
     /* 初始化队列 */
-    s_key_queue = xQueueCreate(KEY_QUEUE_SIZE, sizeof(board_key_t));
+    s_key_queue = xQueueCreate(KEY_QUEUE_SIZE, sizeof(key_event_t));
     if (s_key_queue == NULL) {
         vSemaphoreDelete(s_key_mutex);
         return;
@@ -137,9 +209,25 @@ void board_key_init(void)
     /* 按键状态初始化 */
     memset(s_button_states, 0, sizeof(s_button_states));
 
-    /* 配置 GPIO（仅输入，无中断） */
+    /* 创建扫描定时器（按需启动） */
+    const esp_timer_create_args_t timer_args = {
+        .callback = key_scan_timer_callback,
+        .arg = NULL,
+        .name = "key_scan",
+        .dispatch_method = ESP_TIMER_TASK,  /* 在 timer task 中执行 */
+    };
+
+    esp_err_t ret = esp_timer_create(&timer_args, &s_scan_timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(BOARD_TAG, "Failed to create key scan timer: %s", esp_err_to_name(ret));
+        vSemaphoreDelete(s_key_mutex);
+        vQueueDelete(s_key_queue);
+        return;
+    }
+
+    /* 配置 GPIO：低电平中断（Light Sleep 唤醒仅支持电平触发） */
     gpio_config_t io_conf = {
-        .intr_type = GPIO_INTR_DISABLE,  /* 关闭中断，使用轮询 */
+        .intr_type = GPIO_INTR_LOW_LEVEL,
         .mode = GPIO_MODE_INPUT,
         .pin_bit_mask =
             (1ULL << BOARD_GPIO_KEY_UP) |
@@ -151,43 +239,52 @@ void board_key_init(void)
     };
     gpio_config(&io_conf);
 
-    /* 读取初始状态 */
-    uint32_t init_time = board_time_ms();
+    /* 读取初始状态（上电时已按住的按键直接进入按下状态） */
+    int64_t init_us = esp_timer_get_time();
+    bool any_pressed = false;
     for (int i = 0; i < BUTTON_COUNT; i++) {
         bool raw_state = (gpio_get_level(s_button_gpios[i]) == 0);
         s_button_states[i].is_pressed = raw_state;
-        s_button_states[i].press_start_time = init_time;
+        s_button_states[i].press_start_time = (uint32_t)(init_us / 1000);
+        s_button_states[i].press_edge_us = init_us;
+        any_pressed |= raw_state;
     }
 
-    /* 创建周期定时器进行轮询 */
-    const esp_timer_create_args_t timer_args = {
-        .callback = key_poll_timer_callback,
-        .arg = NULL,
-        .name = "key_poll",
-        .dispatch_method = ESP_TIMER_TASK,  /* 在 timer task 中执行 */
-    };
-    
-    esp_err_t ret = esp_timer_create(&timer_args, &s_poll_timer);
-    if (ret != ESP_OK) {
-        ESP_LOGE(BOARD_TAG, "Failed to create key poll timer: %s", esp_err_to_name(ret));
+    ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(BOARD_TAG, "Failed to install GPIO ISR service: %s", esp_err_to_name(ret));
+        esp_timer_delete(s_scan_timer);
         vSemaphoreDelete(s_key_mutex);
         vQueueDelete(s_key_queue);
         return;
     }
 
-    /* 启动定时器 - 10ms 周期 */
-    ret = esp_timer_start_periodic(s_poll_timer, KEY_POLL_INTERVAL_MS * 1000);
-    if (ret != ESP_OK) {
-        ESP_LOGE(BOARD_TAG, "Failed to start key poll timer: %s", esp_err_to_name(ret));
-        esp_timer_delete(s_poll_timer);
-        vSemaphoreDelete(s_key_mutex);
-        vQueueDelete(s_key_queue);
-        return;
+    for (int i = 0; i < BUTTON_COUNT; i++) {
+        gpio_isr_handler_add(s_button_gpios[i], key_isr_handler, (void*)(intptr_t)i);
+        gpio_wakeup_enable(s_button_gpios[i], GPIO_INTR_LOW_LEVEL);
+        if (s_button_states[i].is_pressed) {
+            gpio_intr_disable(s_button_gpios[i]);  // 由扫描处理，松开后再恢复
+        }
     }
+    esp_sleep_enable_gpio_wakeup();
 
     s_keys_initialized = true;
-    ESP_LOGI(BOARD_TAG, "Key input initialized - polling mode (interval=%dms, debounce=%dms, long_press=%dms)", 
-             KEY_POLL_INTERVAL_MS, DEBOUNCE_TIME_MS, LONG_PRESS_MS);
+    if (any_pressed) {
+        key_scan_start();
+    }
+    ESP_LOGI(BOARD_TAG, "Key input initialized - interrupt mode (scan=%dms while active, debounce=%dms, long_press=%dms)",
+             KEY_SCAN_INTERVAL_MS, DEBOUNCE_TIME_MS, LONG_PRESS_MS);
+}
+
+void board_key_set_event_cb(void (*cb)(void))
+{
+    s_event_cb = cb;
+}
+
+void board_key_get_stats(board_key_stats_t* out)
+{
+    if (out == NULL) return;
+    *out = s_key_stats;
 }
 
 board_key_t board_key_poll(void)
@@ -196,11 +293,21 @@ board_key_t board_key_poll(void)
         return BOARD_KEY_NONE;
     }
 
-    board_key_t key = BOARD_KEY_NONE;
-    if (xQueueReceive(s_key_queue, &key, 0) == pdTRUE) {
-        return key;
+    key_event_t evt;
+    if (xQueueReceive(s_key_queue, &evt, 0) != pdTRUE) {
+        return BOARD_KEY_NONE;
+    }
+
+    // 统计触发沿到消费者取走事件的延迟
+    int64_t latency = esp_timer_get_time() - evt.edge_us;
+    uint32_t latency_us = latency > 0 ? (uint32_t)latency : 0;
+    s_key_stats.events++;
+    s_key_stats.last_latency_us = latency_us;
+    s_key_stats.total_latency_us += latency_us;
+    if (latency_us > s_key_stats.max_latency_us) {
+        s_key_stats.max_latency_us = latency_us;
     }
-    return BOARD_KEY_NONE;
+    return evt.key;
 }
 
 bool board_key_is_pressed(board_key_t key)
@@ -63,6 +63,7 @@ static SemaphoreHandle_t s_mutex       = NULL;
 static bool              s_flashlight  = false;  /* 最高优先级覆盖 */
 static led_layer_t       s_bg          = {0};    /* 背景层（持久） */
 static led_layer_t       s_fg          = {0};    /* 前景层（一次性） */
+static void            (*s_event_cb)(void) = NULL; /* 效果变更通知（唤醒 tick 调用方） */
 
 /* ── GPIO 辅助 ─────────────────────────────────────────────── */
 
@@ -155,6 +156,31 @@ static bool layer_tick(led_layer_t *layer) {
     return true;
 }
 
+/* ── 层下一步时间：距下一次相位切换的 ms，静态效果返回 BOARD_TICK_IDLE ── */
+
+static uint32_t layer_next_ms(const led_layer_t *layer, uint32_t now) {
+    if (!layer->active) return BOARD_TICK_IDLE;
+
+    const led_anim_desc_t *d = &layer->desc;
+    uint32_t interval;
+    switch (d->type) {
+        case LED_ANIM_BLINK:
+            interval = (layer->phase % 2 == 0) ? d->on_ms : d->off_ms;
+            break;
+        case LED_ANIM_MARQUEE:
+            interval = d->on_ms;
+            break;
+        default:
+            return BOARD_TICK_IDLE;
+    }
+    uint32_t elapsed = now - layer->last_ms;
+    return (elapsed >= interval) ? 0 : interval - elapsed;
+}
+
+static void notify_changed(void) {
+    if (s_event_cb) s_event_cb();
+}
+
 /* =========================================================
  * 公开 API
  * ========================================================= */
@@ -188,28 +214,37 @@ void board_leds_init(void) {
     ESP_LOGI(BOARD_TAG, "LEDs initialized (dual-layer v2)");
 }
 
-/* board_leds_tick：在 app_loop 中每 10ms 调用一次 */
-void board_leds_tick(void) {
-    if (!s_initialized) return;
-    if (!leds_lock()) return;
+void board_leds_set_event_cb(void (*cb)(void)) {
+    s_event_cb = cb;
+}
+
+/* board_leds_tick：由 app_task 在事件或上次返回的时间点到达时调用 */
+uint32_t board_leds_tick(void) {
+    if (!s_initialized) return BOARD_TICK_IDLE;
+    if (!leds_lock()) return BOARD_TICK_IDLE;
 
     if (s_flashlight) {
         gpio_write(ALL_ON);
         leds_unlock();
-        return;
+        return BOARD_TICK_IDLE;
     }
 
+    const led_layer_t *running;
     if (s_fg.active) {
         bool still_running = layer_tick(&s_fg);
         if (!still_running) {
             /* 前景完成 → 重播背景，恢复背景 LED 输出 */
             layer_start(&s_bg, s_bg.desc);
         }
+        running = s_fg.active ? &s_fg : &s_bg;
     } else {
         layer_tick(&s_bg);
+        running = &s_bg;
     }
 
+    uint32_t next_ms = layer_next_ms(running, board_time_ms());
     leds_unlock();
+    return next_ms;
 }
 
 /* board_leds_set_mode：统一模式入口，兼容现有调用方 */
@@ -249,6 +284,7 @@ void board_leds_set_mode(board_led_mode_t mode) {
     }
 
     leds_unlock();
+    notify_changed();
     ESP_LOGD(BOARD_TAG, "LED mode=%d oneshot=%d", mode, is_oneshot);
 }
 
@@ -270,6 +306,7 @@ void board_leds_flashlight_off(void) {
         layer_start(&s_bg, s_bg.desc);
     }
     leds_unlock();
+    notify_changed();
     ESP_LOGD(BOARD_TAG, "Flashlight OFF");
 }
 
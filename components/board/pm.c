@@ -0,0 +1,143 @@
+#include "board_pins.h" // BOARD_TAG
+#include "board.h"      // 公共接口
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_pm.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+/*
+ * 动态调频 + 自动 Light Sleep
+ *
+ * CONFIG_PM_ENABLE 打开后，空闲任务在没有任何 PM 锁被持有时让芯片进入 Light Sleep，
+ * BLE 控制器通过 modem sleep 自行维持连接事件。各外设在必须保持时钟的区间内
+ * 通过 board_pm_acquire()/board_pm_release() 持有对应的锁（支持嵌套）。
+ *
+ * 未开启 CONFIG_PM_ENABLE 时锁操作退化为空操作，但持有时长统计照常记录，
+ * 便于对比开关前后的唤醒占空比。
+ */
+
+#define PM_MIN_FREQ_MHZ CONFIG_XTAL_FREQ  // 空闲时降至 XTAL 频率
+
+typedef struct {
+    const char* name;
+    esp_pm_lock_type_t type;
+} pm_lock_desc_t;
+
+static const pm_lock_desc_t s_lock_desc[BOARD_PM_LOCK_COUNT] = {
+    [BOARD_PM_LOCK_DISPLAY] = { "display", ESP_PM_APB_FREQ_MAX },  // I2C 时序依赖 APB
+    [BOARD_PM_LOCK_ADC]     = { "adc",     ESP_PM_APB_FREQ_MAX },  // SAR ADC 采样期间保持时钟
+    [BOARD_PM_LOCK_VIBRATE] = { "vibrate", ESP_PM_APB_FREQ_MAX },  // LEDC 使用 APB 时钟产生 PWM
+    [BOARD_PM_LOCK_BLE]     = { "ble",     ESP_PM_CPU_FREQ_MAX },  // 连接建立阶段满频处理协议栈事件
+};
+
+static esp_pm_lock_handle_t s_locks[BOARD_PM_LOCK_COUNT] = {0};
+static uint8_t s_depth[BOARD_PM_LOCK_COUNT] = {0};
+static int64_t s_held_since_us[BOARD_PM_LOCK_COUNT] = {0};
+static board_pm_stats_t s_stats = {0};
+static uint8_t s_any_depth = 0;        // 当前持有中的锁种类数
+static int64_t s_any_since_us = 0;
+static portMUX_TYPE s_pm_mux = portMUX_INITIALIZER_UNLOCKED;
+static bool s_pm_initialized = false;
+
+esp_err_t board_pm_init(void) {
+  if (s_pm_initialized) {
+    return ESP_OK;
+  }
+
+#if CONFIG_PM_ENABLE
+  esp_pm_config_t pm_config = {
+      .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+      .min_freq_mhz = PM_MIN_FREQ_MHZ,
+      .light_sleep_enable = true,
+  };
+  esp_err_t ret = esp_pm_configure(&pm_config);
+  if (ret != ESP_OK) {
+    ESP_LOGE(BOARD_TAG, "esp_pm_configure failed: %s", esp_err_to_name(ret));
+    return ret;
+  }
+
+  for (int i = 0; i < BOARD_PM_LOCK_COUNT; i++) {
+    ret = esp_pm_lock_create(s_lock_desc[i].type, 0, s_lock_desc[i].name, &s_locks[i]);
+    if (ret != ESP_OK) {
+      ESP_LOGE(BOARD_TAG, "PM lock '%s' create failed: %s", s_lock_desc[i].name,
+               esp_err_to_name(ret));
+      return ret;
+    }
+  }
+  s_stats.enabled = true;
+  ESP_LOGI(BOARD_TAG, "Power management enabled: %d-%d MHz, auto light sleep",
+           PM_MIN_FREQ_MHZ, CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+#else
+  ESP_LOGW(BOARD_TAG, "CONFIG_PM_ENABLE not set, running at fixed CPU frequency");
+#endif
+
+  s_pm_initialized = true;
+  return ESP_OK;
+}
+
+void board_pm_acquire(board_pm_lock_id_t id) {
+  if (id >= BOARD_PM_LOCK_COUNT) return;
+
+  bool first = false;
+  int64_t now = esp_timer_get_time();
+  portENTER_CRITICAL(&s_pm_mux);
+  if (s_depth[id]++ == 0) {
+    first = true;
+    s_held_since_us[id] = now;
+    s_stats.locks[id].acquire_count++;
+    if (s_any_depth++ == 0) {
+      s_any_since_us = now;
+    }
+  }
+  portEXIT_CRITICAL(&s_pm_mux);
+
+  // 只在 0→1 时真正向 esp_pm 申请，嵌套调用只增加计数
+  if (first && s_locks[id] != NULL) {
+    esp_pm_lock_acquire(s_locks[id]);
+  }
+}
+
+void board_pm_release(board_pm_lock_id_t id) {
+  if (id >= BOARD_PM_LOCK_COUNT) return;
+
+  bool last = false;
+  int64_t now = esp_timer_get_time();
+  portENTER_CRITICAL(&s_pm_mux);
+  if (s_depth[id] > 0 && --s_depth[id] == 0) {
+    last = true;
+    s_stats.locks[id].held_us += (uint64_t)(now - s_held_since_us[id]);
+    if (s_any_depth > 0 && --s_any_depth == 0) {
+      s_stats.any_held_us += (uint64_t)(now - s_any_since_us);
+    }
+  }
+  portEXIT_CRITICAL(&s_pm_mux);
+
+  if (last && s_locks[id] != NULL) {
+    esp_pm_lock_release(s_locks[id]);
+  }
+}
+
+void board_pm_get_stats(board_pm_stats_t* out) {
+  if (out == NULL) return;
+
+  int64_t now = esp_timer_get_time();
+  portENTER_CRITICAL(&s_pm_mux);
+  *out = s_stats;
+  // 把仍在持有中的区间计入快照，避免长时间持有的锁在统计中"消失"
+  for (int i = 0; i < BOARD_PM_LOCK_COUNT; i++) {
+    if (s_depth[i] > 0) {
+      out->locks[i].held_us += (uint64_t)(now - s_held_since_us[i]);
+    }
+  }
+  if (s_any_depth > 0) {
+    out->any_held_us += (uint64_t)(now - s_any_since_us);
+  }
+  portEXIT_CRITICAL(&s_pm_mux);
+  out->uptime_us = (uint64_t)now;
+}
+
+const char* board_pm_lock_name(board_pm_lock_id_t id) {
+  return (id < BOARD_PM_LOCK_COUNT) ? s_lock_desc[id].name : "?";
+}
@@ -176,8 +176,10 @@ float board_battery_voltage(void)
     int adc_raw;
     int voltage_mv;
 
-    // 读取原始值
+    // 读取原始值（采样期间禁止进入 Light Sleep）
+    board_pm_acquire(BOARD_PM_LOCK_ADC);
     esp_err_t ret = adc_oneshot_read(s_adc1_handle, s_adc_channel, &adc_raw);
+    board_pm_release(BOARD_PM_LOCK_ADC);
     if (ret != ESP_OK) {
         ESP_LOGW(BOARD_TAG, "ADC read failed: %s", esp_err_to_name(ret));
         return s_cached_voltage; // 返回缓存值
@@ -34,6 +34,8 @@ typedef struct {
 
 static vibrate_state_t s_vib = {0};
 static bool s_initialized = false;
+static bool s_pm_locked = false;    // 模式播放期间持有 PM 锁（LEDC 在 Light Sleep 中停止输出）
+static void (*s_event_cb)(void) = NULL;
 
 /* ================== 内部辅助函数 ================== */
 
@@ -48,6 +50,10 @@ static void set_vibrate_pwm(uint32_t duty) {
 static void stop_vibrate(void) {
     s_vib.active = false;
     set_vibrate_pwm(0);
+    if (s_pm_locked) {
+        s_pm_locked = false;
+        board_pm_release(BOARD_PM_LOCK_VIBRATE);
+    }
     ESP_LOGD(TAG, "Vibration stopped");
 }
 
@@ -123,11 +129,20 @@ void board_vibrate_pattern(const uint32_t* ms_array, uint8_t count) {
     s_vib.step_start_time = board_time_ms();
     s_vib.is_on = true;  // 第一步总是 ON
     s_vib.active = true;
+    if (!s_pm_locked) {
+        s_pm_locked = true;
+        board_pm_acquire(BOARD_PM_LOCK_VIBRATE);
+    }
     
     // 立即启动
     set_vibrate_pwm(VIBRATE_DUTY_MAX);
     
     ESP_LOGD(TAG, "Pattern started: %d steps", count);
+
+    // 通知 tick 调用方按新模式的步进时间唤醒
+    if (s_event_cb) {
+        s_event_cb();
+    }
 }
 
 void board_vibrate_short(void) {
@@ -144,10 +159,14 @@ void board_vibrate_off(void) {
     stop_vibrate();
 }
 
-// 定时器：应在 app_loop 中每 1-10ms 调用一次
-void board_vibrate_tick(void) {
+void board_vibrate_set_event_cb(void (*cb)(void)) {
+    s_event_cb = cb;
+}
+
+// 推进模式：由 app_task 在事件或上次返回的时间点到达时调用
+uint32_t board_vibrate_tick(void) {
     if (!s_initialized || !s_vib.active) {
-        return;
+        return BOARD_TICK_IDLE;
     }
     
     uint32_t now = board_time_ms();
@@ -161,7 +180,7 @@ void board_vibrate_tick(void) {
         if (s_vib.step_idx >= s_vib.count) {
             // 模式完成
             stop_vibrate();
-            return;
+            return BOARD_TICK_IDLE;
         }
         
         // 切换状态：ON -> OFF -> ON ...
@@ -172,7 +191,10 @@ void board_vibrate_tick(void) {
         set_vibrate_pwm(s_vib.is_on ? VIBRATE_DUTY_MAX : 0);
         
         ESP_LOGD(TAG, "Step %d: %s", s_vib.step_idx, s_vib.is_on ? "ON" : "OFF");
+        elapsed = 0;
     }
+
+    return s_vib.durations[s_vib.step_idx] - elapsed;
 }
 
 bool board_vibrate_is_active(void) {
@@ -12,8 +12,6 @@ extern "C" {
  * @brief 消息存储层数据结构（独立于 UI 层）
  * ui_types.h 中的 ui_message_t 是此类型的别名，上层代码无需修改。
  */
-#define MAX_MESSAGES 10
-
 typedef struct {
     char sender[32];
     char text[128];
@@ -23,8 +21,110 @@ typedef struct {
 
 esp_err_t storage_init(void);
 
-esp_err_t storage_save_messages(const storage_message_t* msgs, int count, int current_idx);
-esp_err_t storage_load_messages(storage_message_t* msgs, int* out_count, int* out_current_idx);
+/* ================== 消息紧凑编码 ================== */
+/*
+ * Flash 上的消息不再存放定长 storage_message_t（约 168 字节），而是变长编码：
+ *   [version][flags][timestamp: varint][sender_len][sender][text_len: varint][text]
+ * 字符串不含结尾 '\0'。version 1 为旧的定长结构体，仅在迁移时解码。
+ */
+#define STORAGE_MSG_FORMAT_VERSION  2
+#define STORAGE_MSG_FLAG_READ       0x01
+
+/** 编码后的最大长度（字段全部写满时） */
+#define STORAGE_MSG_ENCODED_MAX \
+    (2 + 5 + 1 + (sizeof(((storage_message_t*)0)->sender) - 1) + \
+     2 + (sizeof(((storage_message_t*)0)->text) - 1))
+
+/**
+ * @brief 将消息编码为紧凑格式
+ * @return 编码后的字节数，缓冲区不足时返回 0
+ */
+size_t storage_message_encode(const storage_message_t* msg, uint8_t* buf, size_t buf_len);
+
+/**
+ * @brief 解码紧凑格式的消息（超长字段截断，保证字符串以 '\0' 结尾）
+ * @return ESP_OK 成功，ESP_ERR_INVALID_VERSION 版本不支持，ESP_ERR_INVALID_SIZE 数据不完整
+ */
+esp_err_t storage_message_decode(const uint8_t* buf, size_t len, storage_message_t* out);
+
+/* ================== 收件箱追加写日志 ================== */
+/*
+ * 收件箱只在内存中保留每条消息的序号与标志（8 字节/条，含对齐填充），正文留在 Flash 中按需读取，
+ * 内存占用与消息条数无关。新增 / 删除 / 标记已读立即更新内存索引，对应的日志记录
+ * 进入待写队列，由 storage_msglog_flush() 在调用方不持锁时写入 NVS；
+ * 失效记录由后台低优先级任务压缩。idx 为按时间从旧到新的消息下标。
+ */
+
+/** 收件箱容量：超出后淘汰最旧的消息；NVS 空间不足时也会提前淘汰 */
+#define STORAGE_INBOX_CAPACITY 200
+
+/**
+ * 待写队列容量。队列满时追加 / 删除 / 已读返回 ESP_ERR_NO_MEM，不会在调用方上下文写 NVS
+ * （调用方通常持有 UI 锁）；需容纳一整批 BLE 批量消息外加尚未刷新的其他变更。
+ */
+#define STORAGE_MSGLOG_PENDING_MAX 16
+
+/** @brief 重放日志重建收件箱索引（首次调用时从旧的整块 blob 格式迁移） */
+esp_err_t storage_msglog_load(void);
+
+/** @brief 当前消息条数 */
+int storage_msglog_count(void);
+
+/** @brief 未读消息条数（O(1)） */
+int storage_msglog_unread_count(void);
+
+/** @brief 收件箱变更序号：每次追加 / 删除 / 已读标记都会递增 */
+uint32_t storage_msglog_seq(void);
+
+/**
+ * @brief 读取 [first, first + n) 范围内的消息
+ * @return 实际读取的条数（遇到越界或读取失败时提前结束）
+ */
+int storage_msglog_read(int first, int n, storage_message_t* out);
+
+/** @brief 追加一条消息；已满时最旧的一条被淘汰 */
+esp_err_t storage_msglog_append(const storage_message_t* msg);
+
+/** @brief 删除第 idx 条消息（写入一条墓碑记录） */
+esp_err_t storage_msglog_delete(int idx);
+
+/** @brief 将第 idx 条消息标记为已读（已读时不写入） */
+esp_err_t storage_msglog_mark_read(int idx);
+
+/** @brief 是否有尚未写入 NVS 的记录 */
+bool storage_msglog_has_pending(void);
+
+/**
+ * @brief 将待写队列中的记录写入 NVS
+ *
+ * 每条记录约 10-50ms，不得在持有上层（UI）锁时调用。
+ */
+esp_err_t storage_msglog_flush(void);
+
+/**
+ * @brief 日志写入统计
+ *
+ * 字节数按 NVS entry（32 字节）粒度估算，legacy_equiv_bytes 为同样的操作序列
+ * 在旧格式（msg_count + cur_idx + 整块 msgs_data，最多 10 条）下的写入量，用于对比写放大。
+ */
+typedef struct {
+    uint32_t appends;
+    uint32_t deletes;
+    uint32_t read_marks;
+    uint32_t evictions;          /**< NVS 空间不足导致的提前淘汰 */
+    uint32_t compactions;
+    uint32_t compact_erases;     /**< 压缩擦除的记录数 */
+    uint64_t append_bytes;
+    uint64_t delete_bytes;
+    uint64_t read_bytes;
+    uint64_t compact_bytes;      /**< 压缩期间写入（已读合并 + 索引） */
+    uint64_t legacy_equiv_bytes;
+    uint32_t last_op_bytes;      /**< 最近一次写入的记录字节数 */
+    uint32_t live_records;
+    uint32_t dead_records;       /**< 待压缩的失效记录 */
+} storage_msglog_stats_t;
+
+void storage_msglog_get_stats(storage_msglog_stats_t* out);
 
 esp_err_t storage_save_ble_addr(const char* addr);
 esp_err_t storage_load_ble_addr(char* buf, size_t buf_len);
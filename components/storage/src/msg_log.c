@@ -0,0 +1,902 @@
+/**
+ * @file msg_log.c
+ * @brief 收件箱追加写日志（log-structured message store）
+ *
+ * 每条消息 / 删除 / 已读标记都是一条独立的 NVS 记录（key = "r<seq>"），
+ * 消息记录为 1 字节类型 + 紧凑编码（storage_message_encode，约 8 字节 + 发送者 + 正文），
+ * 序号单调递增；索引 key "idx" 记录 [head, tail)：
+ *   - 新消息：写 1 条 MSG 记录（满时淘汰最旧消息，重放时按同样规则推导，无需额外写入）
+ *   - 删除：写 1 条 DEL 墓碑记录（引用被删消息的序号）
+ *   - 已读：写 1 条 READ 记录
+ * 索引只在压缩/淘汰时更新；tail 之后连续存在的记录在启动时探测补齐，
+ * 因此常规操作不必每次重写索引。启动时按序号重放 [head, tail) 重建收件箱。
+ *
+ * 内存中只保留有效消息的 {序号, 标志} 索引，正文按需从 Flash 读取。
+ * 变更先更新内存索引并进入待写队列（调用方可持锁调用），
+ * 由 storage_msglog_flush() 在锁外按序号顺序写入。
+ *
+ * 失效记录（被删除/淘汰的消息、墓碑、已合并的 READ）由后台低优先级任务压缩：
+ * 先落盘当前 tail（擦除会在探测区产生空洞），再按序号升序擦除
+ * （墓碑晚于其目标被擦除，掉电不会复活消息），并把 READ 标记合并回消息记录。
+ */
+
+#include "storage.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char* TAG = "msglog";
+
+#define LOG_NAMESPACE       "msglog"
+#define LOG_INDEX_KEY       "idx"
+#define LOG_INDEX_VERSION   1
+#define LOG_KEY_LEN         12
+
+/* 旧格式（整块 blob 重写）所在命名空间与容量，仅用于迁移 */
+#define LEGACY_NAMESPACE    "bipi"
+#define LEGACY_MAX_MESSAGES 10
+
+/* 待写队列长度：满时拒绝新的变更，写入只在 storage_msglog_flush() 中进行 */
+#define PENDING_QUEUE_LEN   STORAGE_MSGLOG_PENDING_MAX
+
+/* NVS 空间不足时，单条记录最多为其淘汰的旧消息数 */
+#define EVICT_MAX_PER_WRITE 8
+
+/* 失效记录累计达到阈值后触发后台压缩 */
+#define COMPACT_DEAD_THRESHOLD   8
+#define COMPACT_TASK_STACK       3072
+#define COMPACT_TASK_PRIORITY    1
+
+/* NVS 每个 entry 32 字节；blob = 数据头 + 数据块 + blob 索引项 */
+#define NVS_ENTRY_SIZE           32
+#define NVS_BLOB_BYTES(len)      ((2 + ((len) + NVS_ENTRY_SIZE - 1) / NVS_ENTRY_SIZE) * NVS_ENTRY_SIZE)
+#define NVS_PRIMITIVE_BYTES      NVS_ENTRY_SIZE
+
+typedef enum {
+    REC_MSG_V1 = 1, /* 旧版定长消息（storage_message_t 原样存储），仅迁移时读取 */
+    REC_DEL    = 2, /* 墓碑：ref = 被删除消息的序号 */
+    REC_READ   = 3, /* 已读标记：ref = 目标消息序号 */
+    REC_MSG    = 4, /* 消息本体，紧凑编码（见 storage_message_encode） */
+} rec_type_t;
+
+#define REC_FLAG_READ  0x01
+
+typedef struct __attribute__((packed)) {
+    uint8_t  type;
+    uint8_t  flags;
+    uint32_t ref;
+} rec_hdr_t;
+
+typedef struct __attribute__((packed)) {
+    rec_hdr_t hdr;
+    storage_message_t msg;
+} rec_msg_v1_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t type;
+    uint8_t data[STORAGE_MSG_ENCODED_MAX];
+} rec_msg_t;
+
+/* 紧凑编码中 flags 字节的下标：[version][flags]... */
+#define MSG_CODEC_FLAGS_OFFSET 1
+
+/* 读取缓冲区：首字节均为记录类型 */
+typedef union {
+    uint8_t type;
+    rec_hdr_t hdr;
+    rec_msg_t msg;
+    rec_msg_v1_t v1;
+} rec_buf_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t version;
+    uint32_t gc;        /* 小于 gc 的记录均已擦除；[gc, head) 失效但可能尚未擦除 */
+    uint32_t head;      /* 重放起点 */
+    uint32_t tail;      /* 落盘时的下一条记录序号（之后的记录启动时探测） */
+} log_index_t;
+
+/* 序号为 32 位，按每秒一条消息也需上百年才会回绕，此处不处理回绕 */
+
+/* 内存索引项：消息记录的序号与状态 */
+#define LIVE_FLAG_READ     0x01
+#define LIVE_FLAG_REWRITE  0x02  /* 记录待重写：合并独立的 READ 标记，或由旧版定长格式升级 */
+
+typedef struct {
+    uint32_t seq;
+    uint8_t  flags;
+} live_entry_t;
+
+/* 待写入 NVS 的记录（按序号递增排列） */
+typedef struct {
+    uint32_t seq;
+    uint8_t  len;
+    union {
+        uint8_t   type;
+        rec_hdr_t hdr;
+        rec_msg_t msg;
+    } rec;
+} pending_rec_t;
+
+/* 环形缓冲：逻辑下标 i（0 = 最旧）对应 s_live[(s_live_head + i) % 容量]，
+ * 追加与淘汰最旧消息均为 O(1)，删除中间条目时移动较短的一侧 */
+static live_entry_t s_live[STORAGE_INBOX_CAPACITY];
+static int s_live_head = 0;
+static int s_live_count = 0;
+static int s_unread_count = 0;
+
+static pending_rec_t s_pending[PENDING_QUEUE_LEN];
+static int s_pending_head = 0;
+static int s_pending_count = 0;
+
+static log_index_t s_index = { LOG_INDEX_VERSION, 0, 0, 0 };  /* tail = 下一个分配的序号 */
+static uint32_t s_flushed_tail = 0;          /* 已写入 NVS 的记录序号上界（= 首条待写记录的序号） */
+static bool s_head_writing = false;          /* 刷新正在锁外写入队首记录的副本，不能再原地修改 */
+static uint32_t s_persisted_tail = 0;        /* 最近一次落盘的索引 tail */
+static uint32_t s_dead_count = 0;            /* 尚未擦除的失效记录数 */
+static uint32_t s_change_seq = 0;            /* 收件箱变更计数（原地修改待写记录也会递增） */
+static SemaphoreHandle_t s_log_mutex = NULL;     /* 保护内存索引与待写队列（只短暂持有） */
+static SemaphoreHandle_t s_flush_mutex = NULL;   /* 串行化 storage_msglog_flush() 的调用者 */
+static TaskHandle_t s_compact_task = NULL;
+static storage_msglog_stats_t s_stats = {0};
+
+/* ================== 内部辅助 ================== */
+
+static void rec_key(uint32_t seq, char* key) {
+    snprintf(key, LOG_KEY_LEN, "r%08lx", (unsigned long)seq);
+}
+
+/* 将消息编码为 MSG 记录，返回记录长度 */
+static size_t pack_msg(const storage_message_t* msg, bool is_read, rec_msg_t* rec) {
+    storage_message_t tmp = *msg;
+    tmp.is_read = is_read;
+    rec->type = REC_MSG;
+    return 1 + storage_message_encode(&tmp, rec->data, sizeof(rec->data));
+}
+
+/* 解码消息记录（紧凑格式或旧版定长格式） */
+static bool unpack_msg(const void* buf, size_t len, storage_message_t* out) {
+    const rec_buf_t* rec = (const rec_buf_t*)buf;
+    if (len > 1 && rec->type == REC_MSG) {
+        return storage_message_decode(rec->msg.data, len - 1, out) == ESP_OK;
+    }
+    if (rec->type == REC_MSG_V1 && len == sizeof(rec_msg_v1_t)) {
+        *out = rec->v1.msg;
+        out->sender[sizeof(out->sender) - 1] = '\0';
+        out->text[sizeof(out->text) - 1] = '\0';
+        out->is_read = (rec->v1.hdr.flags & REC_FLAG_READ) != 0;
+        return true;
+    }
+    return false;
+}
+
+static inline void log_lock(void) {
+    xSemaphoreTake(s_log_mutex, portMAX_DELAY);
+}
+
+static inline void log_unlock(void) {
+    xSemaphoreGive(s_log_mutex);
+}
+
+/* 逻辑下标 → 环形缓冲条目 */
+static inline live_entry_t* live_at(int idx) {
+    int pos = s_live_head + idx;
+    if (pos >= STORAGE_INBOX_CAPACITY) pos -= STORAGE_INBOX_CAPACITY;
+    return &s_live[pos];
+}
+
+/* 序号递增有序，二分查找 */
+static int live_find(uint32_t seq) {
+    int lo = 0, hi = s_live_count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        uint32_t mid_seq = live_at(mid)->seq;
+        if (mid_seq == seq) return mid;
+        if (mid_seq < seq) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return -1;
+}
+
+static void live_remove_at(int idx) {
+    if (!(live_at(idx)->flags & LIVE_FLAG_READ)) s_unread_count--;
+
+    if (idx < s_live_count / 2) {
+        // 靠近最旧端：前段整体后移一格，head 前进
+        for (int i = idx; i > 0; i--) {
+            *live_at(i) = *live_at(i - 1);
+        }
+        s_live_head = (s_live_head + 1) % STORAGE_INBOX_CAPACITY;
+    } else {
+        // 靠近最新端：后段整体前移一格
+        for (int i = idx; i < s_live_count - 1; i++) {
+            *live_at(i) = *live_at(i + 1);
+        }
+    }
+    s_live_count--;
+}
+
+/* 追加一条有效消息；已满时淘汰最旧的一条（重放时按同一规则推导，无需落盘） */
+static void live_push(uint32_t seq, uint8_t flags) {
+    if (s_live_count == STORAGE_INBOX_CAPACITY) {
+        live_remove_at(0);  // idx 0：只移动 head，O(1)
+        s_dead_count++;
+    }
+    live_entry_t* e = live_at(s_live_count);
+    e->seq = seq;
+    e->flags = flags;
+    s_live_count++;
+    if (!(flags & LIVE_FLAG_READ)) s_unread_count++;
+}
+
+static pending_rec_t* pending_find(uint32_t seq) {
+    if (s_pending_count == 0 || seq < s_flushed_tail) return NULL;
+    uint32_t off = seq - s_flushed_tail;
+    if (off >= (uint32_t)s_pending_count) return NULL;
+    if (off == 0 && s_head_writing) return NULL;  // 修改不会进入正在写入的副本
+    return &s_pending[(s_pending_head + (int)off) % PENDING_QUEUE_LEN];
+}
+
+/* 分配序号并放入待写队列，调用方保证队列未满 */
+static uint32_t pending_push(const void* rec, size_t len) {
+    pending_rec_t* p = &s_pending[(s_pending_head + s_pending_count) % PENDING_QUEUE_LEN];
+    p->seq = s_index.tail++;
+    p->len = (uint8_t)len;
+    memcpy(&p->rec, rec, len);
+    s_pending_count++;
+    return p->seq;
+}
+
+/* 加锁并检查待写队列有空位。满时不在此同步写入：调用方可能持有 UI 锁 */
+static bool log_lock_for_write(void) {
+    log_lock();
+    return s_pending_count < PENDING_QUEUE_LEN;
+}
+
+/* 当前索引的落盘快照：tail 取已写入的记录上界。调用方持锁。 */
+static log_index_t index_snapshot_locked(void) {
+    log_index_t idx = s_index;
+    idx.tail = s_flushed_tail;
+    return idx;
+}
+
+/* 写入索引快照（NVS I/O，不访问共享状态，调用方无需持锁） */
+static esp_err_t write_index(nvs_handle_t h, const log_index_t* idx, uint32_t* bytes) {
+    esp_err_t err = nvs_set_blob(h, LOG_INDEX_KEY, idx, sizeof(*idx));
+    if (err == ESP_OK) err = nvs_commit(h);
+    if (err == ESP_OK) *bytes += NVS_BLOB_BYTES(sizeof(*idx));
+    return err;
+}
+
+/*
+ * 锁内快照、锁外写入当前索引。调用方持有 s_flush_mutex 而不持锁：
+ * 索引的全部运行期写入者（刷新中的淘汰、后台压缩）都经由 s_flush_mutex 串行，
+ * 不会把较旧的快照覆盖到较新的之上。
+ */
+static esp_err_t persist_index(nvs_handle_t h, uint32_t* bytes) {
+    log_lock();
+    log_index_t idx = index_snapshot_locked();
+    log_unlock();
+    esp_err_t err = write_index(h, &idx, bytes);
+    if (err == ESP_OK) {
+        log_lock();
+        s_persisted_tail = idx.tail;
+        log_unlock();
+    }
+    return err;
+}
+
+/* 旧格式整块重写一次的字节数（msg_count + cur_idx + msgs_data），用于对比写放大 */
+static uint32_t legacy_equiv_bytes(int count) {
+    if (count > LEGACY_MAX_MESSAGES) count = LEGACY_MAX_MESSAGES;
+    return 2 * NVS_PRIMITIVE_BYTES +
+           (count > 0 ? NVS_BLOB_BYTES(sizeof(storage_message_t) * (size_t)count) : 0);
+}
+
+static void account(uint8_t type, uint32_t bytes) {
+    switch (type) {
+        case REC_MSG:  s_stats.appends++;    s_stats.append_bytes += bytes; break;
+        case REC_DEL:  s_stats.deletes++;    s_stats.delete_bytes += bytes; break;
+        case REC_READ: s_stats.read_marks++; s_stats.read_bytes += bytes;   break;
+        default: break;
+    }
+    s_stats.last_op_bytes = bytes;
+    s_stats.legacy_equiv_bytes += legacy_equiv_bytes(s_live_count);
+}
+
+static void maybe_schedule_compaction(void) {
+    uint32_t pending = s_dead_count;
+    for (int i = 0; i < s_live_count && pending < COMPACT_DEAD_THRESHOLD; i++) {
+        if (live_at(i)->flags & LIVE_FLAG_REWRITE) pending++;
+    }
+    if (pending >= COMPACT_DEAD_THRESHOLD && s_compact_task != NULL) {
+        xTaskNotifyGive(s_compact_task);
+    }
+}
+
+/* 擦除 [start, end) 内的记录（均已失效且 head 已落盘）。NVS I/O 在锁外执行。 */
+static void erase_range(nvs_handle_t h, uint32_t start, uint32_t end) {
+    uint32_t erased = 0;
+    for (uint32_t seq = start; seq < end; seq++) {
+        char key[LOG_KEY_LEN];
+        rec_key(seq, key);
+        if (nvs_erase_key(h, key) == ESP_OK) erased++;
+    }
+    nvs_commit(h);
+
+    log_lock();
+    s_dead_count = (s_dead_count > erased) ? s_dead_count - erased : 0;
+    s_stats.compact_erases += erased;
+    if (s_index.gc < end) s_index.gc = end;
+    log_unlock();
+}
+
+/*
+ * NVS 空间不足：淘汰最旧的消息并立即擦除其之前的全部记录，为序号 seq 的记录腾出空间。
+ * 只有当第二旧的消息早于 seq（均已写入）时才可行。
+ * 由 storage_msglog_flush() 调用（持有 s_flush_mutex、不持锁），NVS I/O 均在锁外执行。
+ */
+static bool evict_for_space(nvs_handle_t h, uint32_t seq) {
+    log_lock();
+    if (s_live_count < 2 || live_at(1)->seq > seq) {
+        log_unlock();
+        return false;
+    }
+    live_remove_at(0);
+    s_dead_count++;
+    s_index.head = live_at(0)->seq;
+    log_index_t idx = index_snapshot_locked();
+    log_unlock();
+
+    // 先把 head / tail 落盘再擦除：被擦除的记录可能位于探测区，先擦除后掉电会留下空洞
+    uint32_t bytes = 0;
+    if (write_index(h, &idx, &bytes) != ESP_OK) return false;
+    erase_range(h, idx.gc, idx.head);
+
+    log_lock();
+    s_persisted_tail = idx.tail;
+    s_stats.compact_bytes += bytes;
+    s_stats.evictions++;
+    log_unlock();
+    ESP_LOGW(TAG, "NVS full, evicted oldest message (head=%lu)", (unsigned long)idx.head);
+    return true;
+}
+
+/* ================== 后台压缩 ================== */
+
+/*
+ * 处理单条记录：擦除失效记录 / 重写待合并或待升级的消息。
+ * 判定在锁内完成，NVS 读写在锁外执行，前台增删不会被压缩阻塞。
+ * 失败时返回 false 中止本轮。
+ */
+static bool compact_one(nvs_handle_t h, uint32_t seq) {
+    char key[LOG_KEY_LEN];
+    rec_key(seq, key);
+
+    log_lock();
+    int li = (seq >= s_index.head) ? live_find(seq) : -1;
+    uint8_t flags = (li >= 0) ? live_at(li)->flags : 0;
+    log_unlock();
+
+    if (li < 0) {
+        // 失效记录（被删除/淘汰的消息、墓碑、READ 标记）：直接擦除，失效记录不会复活
+        esp_err_t err = nvs_erase_key(h, key);
+        if (err == ESP_ERR_NVS_NOT_FOUND) return true;  // 上一轮已擦除
+        if (err == ESP_OK) err = nvs_commit(h);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "erase %s failed: %s", key, esp_err_to_name(err));
+            return false;
+        }
+        log_lock();
+        if (s_dead_count > 0) s_dead_count--;
+        s_stats.compact_erases++;
+        log_unlock();
+        return true;
+    }
+
+    if (!(flags & LIVE_FLAG_REWRITE)) return true;
+
+    // 以紧凑编码重写消息并带上已读标记，之后引用它的 READ 记录即可擦除
+    rec_buf_t rec;
+    storage_message_t msg;
+    size_t len = sizeof(rec);
+    esp_err_t err = nvs_get_blob(h, key, &rec, &len);
+    if (err == ESP_OK && !unpack_msg(&rec, len, &msg)) err = ESP_ERR_INVALID_SIZE;
+    if (err == ESP_OK) {
+        len = pack_msg(&msg, (flags & LIVE_FLAG_READ) != 0, &rec.msg);
+        err = nvs_set_blob(h, key, &rec.msg, len);
+    }
+    if (err == ESP_OK) err = nvs_commit(h);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "rewrite %s failed: %s", key, esp_err_to_name(err));
+        return false;
+    }
+
+    log_lock();
+    s_stats.compact_bytes += NVS_BLOB_BYTES(len);
+    // 重写期间被空间淘汰擦到 head 之下：重写会让 key 复活，而 gc 已越过它，不会再被回收
+    bool stale = seq < s_index.head;
+    // 重写期间又被标记已读时保留标志，下一轮再合并
+    li = stale ? -1 : live_find(seq);
+    if (li >= 0 && live_at(li)->flags == flags) {
+        live_at(li)->flags &= (uint8_t)~LIVE_FLAG_REWRITE;
+    }
+    log_unlock();
+
+    if (stale && nvs_erase_key(h, key) == ESP_OK) {
+        nvs_commit(h);
+        ESP_LOGW(TAG, "rewrite %s raced with eviction, erased", key);
+    }
+    return true;
+}
+
+static void compact_task(void* arg) {
+    (void)arg;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        nvs_handle_t h;
+        if (nvs_open(LOG_NAMESPACE, NVS_READWRITE, &h) != ESP_OK) continue;
+
+        // 只处理已写入的记录；擦除会在 tail 之后的探测区留下空洞，先把当前 tail 落盘。
+        // 索引写入与刷新共用 s_flush_mutex 串行；持有它期间没有刷新在进行，已写入上界不变
+        uint32_t bytes = 0;
+        xSemaphoreTake(s_flush_mutex, portMAX_DELAY);
+        log_lock();
+        uint32_t seq = s_index.gc;
+        uint32_t end = s_flushed_tail;
+        bool stale_tail = s_persisted_tail != end;
+        log_unlock();
+        esp_err_t err = stale_tail ? persist_index(h, &bytes) : ESP_OK;
+        xSemaphoreGive(s_flush_mutex);
+        if (err != ESP_OK) {
+            nvs_close(h);
+            continue;
+        }
+
+        // 按序号升序逐条处理
+        for (; seq < end; seq++) {
+            if (!compact_one(h, seq)) break;
+        }
+
+        xSemaphoreTake(s_flush_mutex, portMAX_DELAY);
+        log_lock();
+        // [gc, seq) 已处理完毕：head 前移到最旧有效消息，但不越过尚未处理的记录
+        uint32_t oldest = (s_live_count > 0) ? live_at(0)->seq : s_index.tail;
+        uint32_t new_head = (oldest < seq) ? oldest : seq;
+        if (new_head < s_index.head) new_head = s_index.head;  // 期间发生过空间淘汰
+        uint32_t new_gc = (seq < new_head) ? seq : new_head;
+        if (new_gc < s_index.gc) new_gc = s_index.gc;
+        bool changed = new_head != s_index.head || new_gc != s_index.gc;
+        s_index.head = new_head;
+        s_index.gc = new_gc;
+        log_unlock();
+        if (changed) {
+            persist_index(h, &bytes);
+        }
+        xSemaphoreGive(s_flush_mutex);
+
+        log_lock();
+        s_stats.compactions++;
+        s_stats.compact_bytes += bytes;
+        ESP_LOGI(TAG, "Compaction done: gc=%lu head=%lu tail=%lu live=%d dead=%lu",
+                 (unsigned long)s_index.gc, (unsigned long)s_index.head,
+                 (unsigned long)s_index.tail, s_live_count, (unsigned long)s_dead_count);
+        log_unlock();
+        nvs_close(h);
+    }
+}
+
+/* ================== 加载 / 迁移 ================== */
+
+/* 按序号重放 [head, tail) 及其后连续存在的记录，重建内存索引 */
+static void replay(nvs_handle_t h, int* upgrades) {
+    s_live_head = 0;
+    s_live_count = 0;
+    s_unread_count = 0;
+    s_dead_count = s_index.head - s_index.gc;  // 估计值，压缩时按实际擦除递减
+
+    uint32_t seq;
+    for (seq = s_index.head; ; seq++) {
+        char key[LOG_KEY_LEN];
+        rec_key(seq, key);
+        rec_buf_t rec;
+        size_t len = sizeof(rec);
+        esp_err_t err = nvs_get_blob(h, key, &rec, &len);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            if (seq >= s_index.tail) break;  // 探测到日志末尾
+            continue;                        // 已被压缩擦除
+        }
+        if (err != ESP_OK || len == 0) {
+            ESP_LOGW(TAG, "Skip unreadable record %s (%s)", key, esp_err_to_name(err));
+            s_dead_count++;
+            continue;
+        }
+        if ((rec.type == REC_DEL || rec.type == REC_READ) && len != sizeof(rec_hdr_t)) {
+            s_dead_count++;
+            continue;
+        }
+
+        switch (rec.type) {
+            case REC_MSG:
+            case REC_MSG_V1: {
+                storage_message_t msg;
+                if (!unpack_msg(&rec, len, &msg)) {
+                    ESP_LOGW(TAG, "Skip corrupt message record %s", key);
+                    s_dead_count++;
+                    break;
+                }
+                uint8_t flags = msg.is_read ? LIVE_FLAG_READ : 0;
+                if (rec.type == REC_MSG_V1) {
+                    // 旧版定长记录：由后台压缩改写为紧凑编码
+                    flags |= LIVE_FLAG_REWRITE;
+                    (*upgrades)++;
+                }
+                live_push(seq, flags);
+                break;
+            }
+
+            case REC_DEL: {
+                int li = live_find(rec.hdr.ref);
+                if (li >= 0) {
+                    live_remove_at(li);
+                    s_dead_count++;  // 被删除的消息记录
+                }
+                s_dead_count++;      // 墓碑本身
+                break;
+            }
+
+            case REC_READ: {
+                int li = live_find(rec.hdr.ref);
+                if (li >= 0 && !(live_at(li)->flags & LIVE_FLAG_READ)) {
+                    live_at(li)->flags |= LIVE_FLAG_READ | LIVE_FLAG_REWRITE;
+                    s_unread_count--;
+                }
+                s_dead_count++;
+                break;
+            }
+
+            default:
+                s_dead_count++;
+                break;
+        }
+    }
+    s_index.tail = seq;
+    s_flushed_tail = seq;
+}
+
+/* 从旧格式（msg_count + cur_idx + 整块 msgs_data）导入到空日志并写入索引，成功后删除旧 key。调用方持锁。 */
+static esp_err_t init_from_legacy_locked(nvs_handle_t h) {
+    static storage_message_t legacy[LEGACY_MAX_MESSAGES];  // 仅启动时使用一次，避免占用栈
+    int32_t count = 0;
+    nvs_handle_t lh;
+    bool has_legacy = (nvs_open(LEGACY_NAMESPACE, NVS_READWRITE, &lh) == ESP_OK);
+
+    if (has_legacy && nvs_get_i32(lh, "msg_count", &count) == ESP_OK) {
+        if (count < 0 || count > LEGACY_MAX_MESSAGES) {
+            ESP_LOGW(TAG, "Invalid legacy msg_count=%ld, discarding", (long)count);
+            count = 0;
+        }
+        size_t sz = sizeof(storage_message_t) * (size_t)count;
+        if (count > 0 && nvs_get_blob(lh, "msgs_data", legacy, &sz) != ESP_OK) {
+            ESP_LOGW(TAG, "Legacy msgs_data unreadable, discarding old messages");
+            count = 0;
+        }
+    }
+
+    uint32_t bytes = 0;
+    esp_err_t err = ESP_OK;
+    for (int i = 0; i < count; i++) {
+        legacy[i].sender[sizeof(legacy[i].sender) - 1] = '\0';
+        legacy[i].text[sizeof(legacy[i].text) - 1] = '\0';
+        rec_msg_t rec;
+        size_t len = pack_msg(&legacy[i], legacy[i].is_read, &rec);
+        char key[LOG_KEY_LEN];
+        rec_key(s_index.tail, key);
+        err = nvs_set_blob(h, key, &rec, len);
+        if (err != ESP_OK) break;
+        bytes += NVS_BLOB_BYTES(len);
+        live_push(s_index.tail, legacy[i].is_read ? LIVE_FLAG_READ : 0);
+        s_index.tail++;
+    }
+    s_flushed_tail = s_index.tail;
+    // 即使没有旧数据也要写入索引，否则下次启动会从序号 0 重新开始（加载期间，尚无其他访问者）
+    if (err == ESP_OK) {
+        log_index_t idx = index_snapshot_locked();
+        err = write_index(h, &idx, &bytes);
+        if (err == ESP_OK) s_persisted_tail = idx.tail;
+    }
+
+    if (has_legacy) {
+        // 迁移成功后删除旧 key（读取失败也清理，避免每次启动重试）；写入失败时保留以便重试
+        if (err == ESP_OK) {
+            nvs_erase_key(lh, "msg_count");
+            nvs_erase_key(lh, "cur_idx");
+            nvs_erase_key(lh, "msgs_data");
+            nvs_commit(lh);
+        }
+        nvs_close(lh);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Log init failed: %s", esp_err_to_name(err));
+    } else if (count > 0) {
+        ESP_LOGI(TAG, "Migrated %d messages from legacy blob (%lu bytes)",
+                 (int)count, (unsigned long)bytes);
+    }
+    return err;
+}
+
+/* ================== 公共接口 ================== */
+
+esp_err_t storage_msglog_load(void) {
+    if (s_log_mutex == NULL) {
+        s_log_mutex = xSemaphoreCreateMutex();
+        s_flush_mutex = xSemaphoreCreateMutex();
+        if (s_log_mutex == NULL || s_flush_mutex == NULL) return ESP_ERR_NO_MEM;
+    }
+    if (s_compact_task == NULL) {
+        xTaskCreate(compact_task, "msglog_gc", COMPACT_TASK_STACK, NULL,
+                    COMPACT_TASK_PRIORITY, &s_compact_task);
+    }
+
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(LOG_NAMESPACE, NVS_READWRITE, &h);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open namespace '%s': %s", LOG_NAMESPACE, esp_err_to_name(err));
+        return err;
+    }
+
+    log_lock();
+    log_index_t idx;
+    size_t len = sizeof(idx);
+    err = nvs_get_blob(h, LOG_INDEX_KEY, &idx, &len);
+    if (err == ESP_OK && len == sizeof(idx) && idx.version == LOG_INDEX_VERSION) {
+        int upgrades = 0;
+        s_index = idx;
+        s_persisted_tail = idx.tail;
+        replay(h, &upgrades);
+        ESP_LOGI(TAG, "Replayed log: head=%lu tail=%lu live=%d unread=%d dead=%lu",
+                 (unsigned long)s_index.head, (unsigned long)s_index.tail,
+                 s_live_count, s_unread_count, (unsigned long)s_dead_count);
+        if (upgrades > 0 && s_compact_task != NULL) {
+            // 旧版定长记录不论数量多少都尽快转为紧凑编码
+            ESP_LOGI(TAG, "%d records in fixed-size format, scheduling upgrade", upgrades);
+            xTaskNotifyGive(s_compact_task);
+        }
+    } else {
+        // 尚无日志：从旧的整块 blob 格式迁移（不存在时即为空收件箱）
+        s_index = (log_index_t){ LOG_INDEX_VERSION, 0, 0, 0 };
+        s_live_head = 0;
+        s_live_count = 0;
+        s_unread_count = 0;
+        err = init_from_legacy_locked(h);
+    }
+    // 变更计数不落盘，从 tail 起步即可保证重启后仍向前推进
+    s_change_seq = s_index.tail;
+    maybe_schedule_compaction();
+    log_unlock();
+    nvs_close(h);
+    return err;
+}
+
+int storage_msglog_count(void) {
+    return s_live_count;
+}
+
+int storage_msglog_unread_count(void) {
+    return s_unread_count;
+}
+
+uint32_t storage_msglog_seq(void) {
+    return s_change_seq;
+}
+
+int storage_msglog_read(int first, int n, storage_message_t* out) {
+    if (!out || first < 0 || n <= 0 || s_log_mutex == NULL) return 0;
+
+    nvs_handle_t h = 0;
+    bool opened = false;
+    int done = 0;
+    for (; done < n; done++) {
+        int idx = first + done;
+        rec_buf_t rec;
+        size_t len = 0;
+
+        log_lock();
+        if (idx >= s_live_count) {
+            log_unlock();
+            break;
+        }
+        uint32_t seq = live_at(idx)->seq;
+        bool is_read = (live_at(idx)->flags & LIVE_FLAG_READ) != 0;
+        pending_rec_t* p = pending_find(seq);
+        if (p) {
+            // 尚未写入 Flash，直接从待写队列解码
+            len = p->len;
+            memcpy(&rec, &p->rec, len);
+        }
+        log_unlock();
+
+        if (len == 0) {
+            if (!opened) {
+                if (nvs_open(LOG_NAMESPACE, NVS_READONLY, &h) != ESP_OK) break;
+                opened = true;
+            }
+            char key[LOG_KEY_LEN];
+            rec_key(seq, key);
+            len = sizeof(rec);
+            if (nvs_get_blob(h, key, &rec, &len) != ESP_OK) break;
+        }
+        if (!unpack_msg(&rec, len, &out[done])) {
+            ESP_LOGW(TAG, "Failed to decode message seq=%lu", (unsigned long)seq);
+            break;
+        }
+        out[done].is_read = is_read;  // 以内存索引为准（READ 记录可能尚未合并）
+    }
+    if (opened) nvs_close(h);
+    return done;
+}
+
+esp_err_t storage_msglog_append(const storage_message_t* msg) {
+    if (!msg) return ESP_ERR_INVALID_ARG;
+    if (s_log_mutex == NULL) return ESP_ERR_INVALID_STATE;
+
+    rec_msg_t rec;
+    size_t len = pack_msg(msg, msg->is_read, &rec);
+
+    if (!log_lock_for_write()) {
+        log_unlock();
+        ESP_LOGE(TAG, "append failed: pending queue full");
+        return ESP_ERR_NO_MEM;
+    }
+    uint32_t seq = pending_push(&rec, len);
+    live_push(seq, msg->is_read ? LIVE_FLAG_READ : 0);
+    s_change_seq++;
+    log_unlock();
+
+    ESP_LOGD(TAG, "append seq=%lu (%u bytes queued)", (unsigned long)seq, (unsigned)len);
+    return ESP_OK;
+}
+
+esp_err_t storage_msglog_delete(int idx) {
+    if (s_log_mutex == NULL) return ESP_ERR_INVALID_STATE;
+
+    if (!log_lock_for_write()) {
+        log_unlock();
+        ESP_LOGE(TAG, "delete failed: pending queue full");
+        return ESP_ERR_NO_MEM;
+    }
+    if (idx < 0 || idx >= s_live_count) {
+        log_unlock();
+        return ESP_ERR_INVALID_ARG;
+    }
+    rec_hdr_t rec = { .type = REC_DEL, .flags = 0, .ref = live_at(idx)->seq };
+    pending_push(&rec, sizeof(rec));
+    live_remove_at(idx);
+    s_dead_count += 2;  // 被删除的消息 + 墓碑
+    s_change_seq++;
+    log_unlock();
+    return ESP_OK;
+}
+
+esp_err_t storage_msglog_mark_read(int idx) {
+    if (s_log_mutex == NULL) return ESP_ERR_INVALID_STATE;
+
+    if (!log_lock_for_write()) {
+        log_unlock();
+        ESP_LOGE(TAG, "mark_read failed: pending queue full");
+        return ESP_ERR_NO_MEM;
+    }
+    if (idx < 0 || idx >= s_live_count) {
+        log_unlock();
+        return ESP_ERR_INVALID_ARG;
+    }
+    live_entry_t* e = live_at(idx);
+    if (!(e->flags & LIVE_FLAG_READ)) {
+        e->flags |= LIVE_FLAG_READ;
+        s_unread_count--;
+        s_change_seq++;
+        pending_rec_t* p = pending_find(e->seq);
+        if (p && p->rec.type == REC_MSG) {
+            // 消息本身尚未写入：直接修改待写记录，省去一条 READ 记录
+            p->rec.msg.data[MSG_CODEC_FLAGS_OFFSET] |= STORAGE_MSG_FLAG_READ;
+        } else {
+            rec_hdr_t rec = { .type = REC_READ, .flags = 0, .ref = e->seq };
+            pending_push(&rec, sizeof(rec));
+            e->flags |= LIVE_FLAG_REWRITE;
+            s_dead_count++;  // READ 记录合并后即失效
+        }
+    }
+    log_unlock();
+    return ESP_OK;
+}
+
+bool storage_msglog_has_pending(void) {
+    return s_pending_count > 0;
+}
+
+esp_err_t storage_msglog_flush(void) {
+    if (s_log_mutex == NULL) return ESP_ERR_INVALID_STATE;
+    if (s_pending_count == 0) return ESP_OK;
+
+    xSemaphoreTake(s_flush_mutex, portMAX_DELAY);
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(LOG_NAMESPACE, NVS_READWRITE, &h);
+    if (err != ESP_OK) {
+        xSemaphoreGive(s_flush_mutex);
+        return err;
+    }
+
+    // 整个待写队列（例如一批新消息）只提交一次
+    int evictions = 0;
+    int written = 0;
+    for (;;) {
+        // 复制队首记录后释放锁，写入期间前台仍可继续入队
+        pending_rec_t p;
+        log_lock();
+        if (s_pending_count == 0) {
+            log_unlock();
+            break;
+        }
+        p = s_pending[s_pending_head];
+        s_head_writing = true;
+        log_unlock();
+
+        char key[LOG_KEY_LEN];
+        rec_key(p.seq, key);
+        err = nvs_set_blob(h, key, &p.rec, p.len);
+
+        if (err == ESP_ERR_NVS_NOT_ENOUGH_SPACE && evictions < EVICT_MAX_PER_WRITE) {
+            log_lock();
+            s_head_writing = false;
+            log_unlock();
+            bool evicted = evict_for_space(h, p.seq);
+            if (evicted) {
+                evictions++;
+                continue;
+            }
+        }
+        if (err != ESP_OK) {
+            // 保留在队列中，下次刷新重试（跳过会在探测区留下空洞）
+            ESP_LOGE(TAG, "write %s failed: %s", key, esp_err_to_name(err));
+            log_lock();
+            s_head_writing = false;
+            log_unlock();
+            break;
+        }
+
+        log_lock();
+        s_head_writing = false;
+        s_pending_head = (s_pending_head + 1) % PENDING_QUEUE_LEN;
+        s_pending_count--;
+        s_flushed_tail = p.seq + 1;
+        account(p.rec.type, NVS_BLOB_BYTES(p.len));
+        log_unlock();
+        evictions = 0;
+        written++;
+    }
+    if (written > 0) {
+        esp_err_t commit_err = nvs_commit(h);
+        if (err == ESP_OK) err = commit_err;
+    }
+    nvs_close(h);
+    xSemaphoreGive(s_flush_mutex);
+
+    log_lock();
+    maybe_schedule_compaction();
+    log_unlock();
+    return err;
+}
+
+void storage_msglog_get_stats(storage_msglog_stats_t* out) {
+    if (!out) return;
+    if (s_log_mutex != NULL) log_lock();
+    *out = s_stats;
+    out->live_records = (uint32_t)s_live_count;
+    out->dead_records = s_dead_count;
+    if (s_log_mutex != NULL) log_unlock();
+}
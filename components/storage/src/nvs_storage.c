@@ -29,87 +29,79 @@ esp_err_t storage_init(void) {
     return ESP_OK;
 }
 
-/**
- * @brief 将消息数组以 blob 方式序列化存储
- *
- * 旧格式使用每条消息4个独立 key（m0_s/m0_t/m0_ts/m0_r × 10条 = 40+个key），
- * 新格式使用3个key（msg_count + cur_idx + msgs_data blob），
- * 大幅减少 NVS 写入次数，降低 Flash 磨损。
- */
-esp_err_t storage_save_messages(const storage_message_t* msgs, int count, int current_idx) {
-    if (!msgs || count < 0 || count > MAX_MESSAGES) return ESP_ERR_INVALID_ARG;
+/* 消息收件箱的持久化见 msg_log.c（追加写日志），记录内的消息使用以下紧凑编码。 */
 
-    nvs_handle_t h;
-    esp_err_t err = nvs_open(NAMESPACE, NVS_READWRITE, &h);
-    if (err != ESP_OK) return err;
-
-    err = nvs_set_i32(h, "msg_count", count);
-    if (err != ESP_OK) goto _close;
-
-    err = nvs_set_i32(h, "cur_idx", current_idx);
-    if (err != ESP_OK) goto _close;
-
-    if (count > 0) {
-        err = nvs_set_blob(h, "msgs_data", msgs, sizeof(storage_message_t) * (size_t)count);
-        if (err != ESP_OK) goto _close;
+static size_t varint_put(uint8_t* p, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
     }
-
-    err = nvs_commit(h);
-
-_close:
-    nvs_close(h);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "storage_save_messages failed: %s", esp_err_to_name(err));
-    }
-    return err;
+    p[n++] = (uint8_t)v;
+    return n;
 }
 
-esp_err_t storage_load_messages(storage_message_t* msgs, int* out_count, int* out_current_idx) {
-    if (!msgs || !out_count || !out_current_idx) return ESP_ERR_INVALID_ARG;
-
-    *out_count = 0;
-    *out_current_idx = 0;
-
-    nvs_handle_t h;
-    esp_err_t err = nvs_open(NAMESPACE, NVS_READONLY, &h);
-    if (err != ESP_OK) {
-        // 命名空间不存在视为空存储，属于正常情况
-        if (err == ESP_ERR_NVS_NOT_FOUND) return ESP_OK;
-        return err;
-    }
-
-    int32_t msg_count = 0;
-    int32_t cur_idx = 0;
-    nvs_get_i32(h, "msg_count", &msg_count);
-    nvs_get_i32(h, "cur_idx", &cur_idx);
-
-    // 边界校验
-    if (msg_count < 0 || msg_count > MAX_MESSAGES) {
-        ESP_LOGW(TAG, "Invalid msg_count=%ld in NVS, resetting to 0", msg_count);
-        msg_count = 0;
-    }
-    if (cur_idx < 0 || (msg_count > 0 && cur_idx >= msg_count)) {
-        cur_idx = 0;
-    }
-
-    if (msg_count > 0) {
-        size_t sz = sizeof(storage_message_t) * (size_t)msg_count;
-        err = nvs_get_blob(h, "msgs_data", msgs, &sz);
-        if (err != ESP_OK) {
-            // blob 读取失败（可能是从旧格式升级），丢弃历史消息，从零开始
-            ESP_LOGW(TAG, "msgs_data blob read failed (%s), discarding old messages",
-                     esp_err_to_name(err));
-            msg_count = 0;
-            cur_idx = 0;
-            err = ESP_OK; // 非致命错误
+static bool varint_get(const uint8_t* p, size_t len, size_t* pos, uint32_t* out) {
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35 && *pos < len; shift += 7) {
+        uint8_t b = p[(*pos)++];
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *out = v;
+            return true;
         }
     }
+    return false;
+}
 
-    *out_count = (int)msg_count;
-    *out_current_idx = (int)cur_idx;
+size_t storage_message_encode(const storage_message_t* msg, uint8_t* buf, size_t buf_len) {
+    if (!msg || !buf || buf_len < STORAGE_MSG_ENCODED_MAX) return 0;
+
+    size_t sender_len = strnlen(msg->sender, sizeof(msg->sender) - 1);
+    size_t text_len = strnlen(msg->text, sizeof(msg->text) - 1);
+    size_t n = 0;
+
+    buf[n++] = STORAGE_MSG_FORMAT_VERSION;
+    buf[n++] = msg->is_read ? STORAGE_MSG_FLAG_READ : 0;
+    n += varint_put(&buf[n], msg->timestamp);
+    buf[n++] = (uint8_t)sender_len;
+    memcpy(&buf[n], msg->sender, sender_len);
+    n += sender_len;
+    n += varint_put(&buf[n], (uint32_t)text_len);
+    memcpy(&buf[n], msg->text, text_len);
+    n += text_len;
+    return n;
+}
 
-    nvs_close(h);
-    return err;
+esp_err_t storage_message_decode(const uint8_t* buf, size_t len, storage_message_t* out) {
+    if (!buf || !out) return ESP_ERR_INVALID_ARG;
+    if (len < 2) return ESP_ERR_INVALID_SIZE;
+    if (buf[0] != STORAGE_MSG_FORMAT_VERSION) return ESP_ERR_INVALID_VERSION;
+
+    size_t pos = 1;
+    uint8_t flags = buf[pos++];
+    uint32_t timestamp = 0;
+    uint32_t text_len = 0;
+    if (!varint_get(buf, len, &pos, &timestamp) || pos >= len) return ESP_ERR_INVALID_SIZE;
+
+    size_t sender_len = buf[pos++];
+    if (sender_len > len - pos) return ESP_ERR_INVALID_SIZE;
+    const uint8_t* sender = &buf[pos];
+    pos += sender_len;
+
+    if (!varint_get(buf, len, &pos, &text_len) || text_len > len - pos) return ESP_ERR_INVALID_SIZE;
+    const uint8_t* text = &buf[pos];
+
+    // 超出 RAM 结构容量的部分截断
+    if (sender_len > sizeof(out->sender) - 1) sender_len = sizeof(out->sender) - 1;
+    if (text_len > sizeof(out->text) - 1) text_len = sizeof(out->text) - 1;
+
+    memset(out, 0, sizeof(*out));
+    memcpy(out->sender, sender, sender_len);
+    memcpy(out->text, text, text_len);
+    out->timestamp = timestamp;
+    out->is_read = (flags & STORAGE_MSG_FLAG_READ) != 0;
+    return ESP_OK;
 }
 
 esp_err_t storage_save_ble_addr(const char* addr) {
@@ -0,0 +1,182 @@
+/*
+ * 消息页逐帧文本开销基准（主机端）
+ *
+ * 对比 ui_text 排版缓存之前的渲染循环（每帧对每行逐字符追加后用
+ * board_display_text_width() 重测整个前缀，O(n^2)）与 ui_text_layout_build() /
+ * ui_text_layout_draw()。字形宽度为桩：中文 12px、ASCII 6px（wqy12），
+ * board_display_text_width() 与 u8g2_GetUTF8Width() 一样每个字符查一次字形。
+ *
+ * 桩的字形查询远比设备上在 GB2312 字体中查找字形便宜，耗时只作相对参考；
+ * 字形查询次数与平台无关，作为回归判据：排版缓存的逐帧绘制不得再查询字形。
+ */
+#include "ui_text.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#define AREA_WIDTH      (128 - 2 - 4)
+#define LINE_HEIGHT     13
+#define CONTENT_START_Y 40
+#define SCREEN_HEIGHT   64
+#define FRAMES          200000
+
+static long s_glyph_lookups;
+static long s_lines_drawn;
+static volatile int s_sink;
+
+/* ================== 显示接口桩 ================== */
+
+__attribute__((noinline)) int board_display_glyph_width(uint16_t encoding) {
+    s_glyph_lookups++;
+    return encoding < 0x80 ? 6 : 12;
+}
+
+static int utf8_next(const char* s, uint16_t* cp) {
+    unsigned char c = (unsigned char)s[0];
+    if (c < 0x80) { *cp = c; return 1; }
+    if ((c & 0xE0) == 0xC0) { *cp = (uint16_t)(((c & 0x1F) << 6) | (s[1] & 0x3F)); return 2; }
+    if ((c & 0xF0) == 0xE0) {
+        *cp = (uint16_t)(((c & 0x0F) << 12) | ((s[1] & 0x3F) << 6) | (s[2] & 0x3F));
+        return 3;
+    }
+    *cp = '?';
+    return 4;
+}
+
+// 与 u8g2_GetUTF8Width() 相同：每个字符查询一次字形
+__attribute__((noinline)) int board_display_text_width(const char* text) {
+    int w = 0;
+    uint16_t cp;
+    while (*text) {
+        text += utf8_next(text, &cp);
+        w += board_display_glyph_width(cp);
+    }
+    return w;
+}
+
+__attribute__((noinline)) void board_display_text(int x, int y, const char* text) {
+    s_lines_drawn++;
+    s_sink += x + y + text[0];
+}
+
+void board_display_set_font(const void* font) {
+    (void)font;
+}
+
+/* ================== 旧实现（ui_text 排版缓存之前的消息页渲染循环） ================== */
+
+static void legacy_render(const char* text, int vertical_offset) {
+    const int left = 2;
+    const char* p = text;
+    int y = CONTENT_START_Y - vertical_offset;
+    char line_buf[128];
+
+    while (*p) {
+        int pos = 0;
+        int i = 0;
+        while (p[i] != '\0') {
+            unsigned char c = (unsigned char)p[i];
+            int char_len = 1;
+            if (c < 0x80) char_len = 1;
+            else if ((c & 0xE0) == 0xC0) char_len = 2;
+            else if ((c & 0xF0) == 0xE0) char_len = 3;
+            else if ((c & 0xF8) == 0xF0) char_len = 4;
+
+            if (pos + char_len >= (int)sizeof(line_buf) - 1) break;
+            memcpy(&line_buf[pos], &p[i], char_len);
+            pos += char_len;
+            line_buf[pos] = '\0';
+
+            int w = board_display_text_width(line_buf);
+            if (w > AREA_WIDTH) {
+                while (pos > 0 && ((unsigned char)line_buf[pos - 1] & 0xC0) == 0x80) pos--;
+                if (pos > 0) pos--;
+                line_buf[pos] = '\0';
+                break;
+            }
+            i += char_len;
+        }
+        if (pos == 0 && p[0]) {
+            uint16_t cp;
+            i = utf8_next(p, &cp);
+            memcpy(line_buf, p, (size_t)i);
+            line_buf[i] = '\0';
+        }
+        if (y >= CONTENT_START_Y - LINE_HEIGHT && y < SCREEN_HEIGHT) {
+            board_display_text(left, y, line_buf);
+        }
+        y += LINE_HEIGHT;
+        p += (i > 0 ? i : 1);
+    }
+}
+
+/* ================== 计时 ================== */
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+int main(void) {
+    // 128 字节以内的纯中文消息（42 个汉字 = 126 字节）
+    static const char* const han[] = { "你", "好", "世", "界", "消", "息", "测", "试" };
+    char text[129] = {0};
+    for (int i = 0; strlen(text) + 3 <= 128; i++) {
+        strcat(text, han[i % 8]);
+    }
+    int chars = (int)strlen(text) / 3;
+
+    // 旧实现：每帧完整重排并逐字符重测前缀
+    s_glyph_lookups = s_lines_drawn = 0;
+    legacy_render(text, 0);
+    long legacy_lookups = s_glyph_lookups, legacy_lines = s_lines_drawn;
+    double t0 = now_ns();
+    for (int f = 0; f < FRAMES; f++) legacy_render(text, f & 7);
+    double legacy_ns = (now_ns() - t0) / FRAMES;
+
+    // 新实现：文本 / 字体 / 宽度变化时排版一次
+    ui_text_layout_t layout;
+    s_glyph_lookups = 0;
+    ui_text_layout_build(&layout, text, NULL, AREA_WIDTH, LINE_HEIGHT);
+    long build_lookups = s_glyph_lookups;
+    t0 = now_ns();
+    for (int f = 0; f < FRAMES; f++) ui_text_layout_build(&layout, text, NULL, AREA_WIDTH, LINE_HEIGHT);
+    double build_ns = (now_ns() - t0) / FRAMES;
+
+    // 新实现：每帧只按行偏移绘制可见行
+    s_glyph_lookups = s_lines_drawn = 0;
+    ui_text_layout_draw(&layout, text, 2, CONTENT_START_Y, CONTENT_START_Y - LINE_HEIGHT, SCREEN_HEIGHT);
+    long draw_lookups = s_glyph_lookups, draw_lines = s_lines_drawn;
+    t0 = now_ns();
+    for (int f = 0; f < FRAMES; f++) {
+        ui_text_layout_draw(&layout, text, 2, CONTENT_START_Y - (f & 7),
+                            CONTENT_START_Y - LINE_HEIGHT, SCREEN_HEIGHT);
+    }
+    double draw_ns = (now_ns() - t0) / FRAMES;
+
+    printf("text: %zu bytes, %d CJK chars, %d lines at %d px\n",
+           strlen(text), chars, layout.line_count, AREA_WIDTH);
+    printf("legacy render / frame : %8.0f ns  %4ld glyph lookups  %ld lines drawn\n",
+           legacy_ns, legacy_lookups, legacy_lines);
+    printf("layout build  / change: %8.0f ns  %4ld glyph lookups\n", build_ns, build_lookups);
+    printf("layout draw   / frame : %8.0f ns  %4ld glyph lookups  %ld lines drawn\n",
+           draw_ns, draw_lookups, draw_lines);
+
+    // 回归判据：排版每个字符只查一次字形，逐帧绘制不查询，且与旧实现绘制相同的行数
+    int failed = 0;
+    if (build_lookups != chars) {
+        printf("FAIL: layout build made %ld glyph lookups, expected %d\n", build_lookups, chars);
+        failed = 1;
+    }
+    if (draw_lookups != 0) {
+        printf("FAIL: layout draw made %ld glyph lookups per frame\n", draw_lookups);
+        failed = 1;
+    }
+    if (draw_lines != legacy_lines) {
+        printf("FAIL: layout draw drew %ld lines, legacy drew %ld\n", draw_lines, legacy_lines);
+        failed = 1;
+    }
+    return failed;
+}
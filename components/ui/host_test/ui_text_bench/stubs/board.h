@@ -0,0 +1,9 @@
+#pragma once
+/* 主机基准用的 board.h 桩：只声明 ui_text.c 用到的显示接口，实现在 main.c */
+#include <stdint.h>
+#include <stdbool.h>
+
+void board_display_text(int x, int y, const char* text);
+void board_display_set_font(const void* font);
+int board_display_text_width(const char* text);
+int board_display_glyph_width(uint16_t encoding);
@@ -0,0 +1,2 @@
+#pragma once
+/* 主机基准用的 u8g2.h 桩：ui_text.c 不直接调用 u8g2 */
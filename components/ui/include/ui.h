@@ -22,8 +22,11 @@ typedef enum {
 
 /* ================== UI 核心接口 ================== */
 
+/* ui_tick 返回此值表示无需定时唤醒（屏幕已关闭），仅在 ui_request_redraw 时唤醒 */
+#define UI_TICK_SLEEP_FOREVER UINT32_MAX
+
 void ui_init(void);
-uint32_t ui_tick(void); // 返回下一次 tick 的等待时间 (ms)
+uint32_t ui_tick(void); // 返回下一次 tick 的等待时间 (ms)，或 UI_TICK_SLEEP_FOREVER
 void ui_on_key(board_key_t key);
 void ui_change_page(ui_state_enum_t new_state);
 
@@ -40,15 +43,40 @@ void ui_request_redraw(void);
 void ui_set_redraw_callback(void (*cb)(void));
 
 /* ================== 消息数据接口 ================== */
+/* 消息窗口大小：列表每页条数，窗口缓存按此对齐 */
+#define UI_MSG_WINDOW_SIZE 4
+
 int ui_get_message_count(void);
 int ui_get_unread_count(void);
 int ui_get_current_message_idx(void);
 void ui_set_current_message_idx(int idx);
+/**
+ * @brief 获取第 idx 条消息（持锁调用）
+ *
+ * 返回窗口缓存中的条目：同一窗口内为 O(1)，跨窗口时从 Flash 装载一页。
+ * 指针在下一次跨窗口访问或消息增删后失效，调用方应立即复制所需字段。
+ */
 ui_message_t* ui_get_message_at(int idx);
+// 标记第 idx 条消息为已读（持锁调用，持久化延迟到 ui_flush_pending_saves）
+void ui_mark_message_read(int idx);
 
 /* ================== 业务接口 ================== */
+/** 待显示的一条新消息（字段指向调用方缓冲区，仅在调用期间有效） */
+typedef struct {
+    const char* sender;
+    const char* text;
+    uint32_t timestamp;
+} ui_message_ref_t;
+
 void ui_show_message(const char* sender, const char* text);
 void ui_show_message_with_timestamp(const char* sender, const char* text, uint32_t timestamp);
+/**
+ * @brief 一次收下多条新消息
+ *
+ * 全部消息在一次加锁内追加到收件箱，之后只刷新一次存储、只提醒一次，
+ * 并跳转到最新一条。必须在 app_task 上下文中、非锁内调用。
+ */
+void ui_show_messages(const ui_message_ref_t* msgs, int count);
 void ui_delete_current_message(void);
 void ui_enter_standby(void);
 void ui_wake_up(void);
@@ -70,14 +98,21 @@ void ui_system_restart(void);
 /**
  * @brief 刷新待执行的延迟 NVS 持久化操作
  *
- * ui_delete_current_message() 和 ui_set_brightness() 在 ui_on_key() 持锁时
- * 被调用，不能在锁内直接写 NVS（约 10-50ms）。它们会将待写数据快照到模块变量，
- * 然后由 app_loop() 在无锁状态下调用此函数完成实际写入。
+ * 消息的新增 / 删除 / 已读以及 ui_set_brightness() 都发生在持有 UI 锁期间，
+ * 不能在锁内直接写 NVS（约 10-50ms）。消息变更由存储层立即更新内存索引并排入
+ * 消息日志的待写队列（见 storage_msglog_flush()），亮度在 UI 内快照；随后通过
+ * ui_set_save_callback() 注册的回调通知 app_task，由其在无锁状态下调用此函数：
+ * 整个待写队列写入后只做一次 nvs_commit，再保存亮度。
  *
  * 必须在 app_task 上下文中、非锁内调用。
  */
 void ui_flush_pending_saves(void);
 
+/**
+ * @brief 设置保存请求回调（有待写入数据时调用，通常用于唤醒 app_task）
+ */
+void ui_set_save_callback(void (*cb)(void));
+
 /* ================== Toast / HUD 接口 ================== */
 /**
  * @brief 在屏幕中央弹出文字提示（类 Android Toast）
@@ -22,15 +22,10 @@ void ui_render_main(int message_count, int unread_count);
 void ui_render_message_read(const ui_message_t* msg, int current_idx, int total_count, int vertical_offset);
 
 /**
- * @brief 渲染待机界面 (清屏)
+ * @brief 渲染待机屏保动画帧
  */
 void ui_render_standby(void);
 
-/**
- * @brief 重置待机计时器（进入待机时调用）
- */
-void ui_render_standby_reset_timer(void);
-
 /**
  * @brief 渲染开机 LOGO
  */
@@ -1,9 +1,52 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 
 // 在指定最大像素宽度内绘制文本，超出的部分以省略号替换（UTF-8 安全）
 void ui_draw_text_clipped(int x, int y, int max_width, const char* text);
 
 // 在指定区域内水平居中绘制文本（会自动使用 max_width = area_width）
 void ui_draw_text_centered(int area_x, int area_y, int area_width, const char* text);
+
+/* ================== 多行文本排版缓存 ================== */
+
+/* 单条消息最多排出的行数（240 字节正文在 122px 宽度下约 24 行，留余量） */
+#define UI_TEXT_LAYOUT_MAX_LINES 32
+
+/**
+ * @brief 多行文本排版结果
+ *
+ * 记录每一行在原文中的起始字节偏移，line_start[line_count] 为文本结尾。
+ * 排版只依赖 (文本, 字体, 宽度)，计算一次后渲染与滚动只需遍历偏移数组，
+ * 不再对每一帧逐字符测量整行前缀宽度。
+ */
+typedef struct {
+    const void* font;                                   /**< 排版时使用的字体 */
+    int width;                                          /**< 排版区域宽度 (px) */
+    int line_height;                                    /**< 行高 (px) */
+    int total_height;                                   /**< 内容总高度 (px) */
+    uint8_t line_count;                                 /**< 行数 */
+    uint16_t line_start[UI_TEXT_LAYOUT_MAX_LINES + 1];  /**< 各行起始字节偏移 */
+} ui_text_layout_t;
+
+/**
+ * @brief 按像素宽度计算文本断行
+ *
+ * 逐字符累加字形步进宽度（O(n)），结果写入 layout。会将当前字体切换为 font。
+ */
+void ui_text_layout_build(ui_text_layout_t* layout, const char* text,
+                          const void* font, int width, int line_height);
+
+/** @brief 排版缓存是否仍适用于给定字体与宽度 */
+bool ui_text_layout_matches(const ui_text_layout_t* layout, const void* font, int width);
+
+/**
+ * @brief 按排版结果绘制文本
+ *
+ * @param y        第一行基线 Y 坐标（已减去滚动偏移）
+ * @param clip_top 仅绘制基线 >= clip_top 的行
+ * @param clip_bottom 仅绘制基线 < clip_bottom 的行
+ */
+void ui_text_layout_draw(const ui_text_layout_t* layout, const char* text,
+                         int x, int y, int clip_top, int clip_bottom);
@@ -12,8 +12,8 @@
 
 static const char* TAG = "PAGE_LIST";
 
-// 每页显示项数（根据屏幕高度与行高调整）
-#define ITEMS_PER_PAGE 4
+// 每页显示项数（与消息窗口缓存对齐，翻页时才从 Flash 读取）
+#define ITEMS_PER_PAGE UI_MSG_WINDOW_SIZE
 #define LINE_HEIGHT 12
 #define STATUS_BAR_Y 10
 #define CONTENT_START_Y 24
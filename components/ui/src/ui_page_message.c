@@ -19,63 +19,20 @@ static const char* TAG = "PAGE_MSG";
 #define SCROLL_STEP 12
 #define HEADER_HEIGHT 28
 #define CONTENT_START_Y 40
+#define CONTENT_LEFT 2
+#define CONTENT_WIDTH (128 - 2 - 4)
 
 static int s_vertical_offset = 0;
-static int s_content_height = 0;  // 内容总高度
 
 static void page_on_enter(void) {
     ESP_LOGD(TAG, "Entering Message Page");
     s_vertical_offset = 0;
-    s_content_height = 0;
 }
 
 static void page_on_exit(void) {
     // 清理状态
 }
 
-// 计算消息内容的总高度
-static int calculate_content_height(const char* text, int area_width) {
-    if (!text || !text[0]) return LINE_HEIGHT;
-    
-    int total_height = 0;
-    const char *p = text;
-    char line_buf[128];
-    
-    while (*p) {
-        int pos = 0;
-        int i = 0;
-        while (p[i] != '\0') {
-            unsigned char c = (unsigned char)p[i];
-            int char_len = 1;
-            if (c < 0x80) char_len = 1;
-            else if ((c & 0xE0) == 0xC0) char_len = 2;
-            else if ((c & 0xF0) == 0xE0) char_len = 3;
-            else if ((c & 0xF8) == 0xF0) char_len = 4;
-
-            if (pos + char_len >= (int)sizeof(line_buf) - 1) break;
-            memcpy(&line_buf[pos], &p[i], char_len);
-            pos += char_len;
-            line_buf[pos] = '\0';
-
-            int w = board_display_text_width(line_buf);
-            if (w > area_width) {
-                // 回退
-                while (pos > 0 && ((unsigned char)line_buf[pos-1] & 0xC0) == 0x80) pos--;
-                if (pos > 0) pos--;
-                break;
-            }
-            i += char_len;
-        }
-        if (pos == 0 && p[0]) {
-            i = 1;
-        }
-        total_height += LINE_HEIGHT;
-        p += (i > 0 ? i : 1);
-    }
-    
-    return total_height > 0 ? total_height : LINE_HEIGHT;
-}
-
 // 渲染上下文
 typedef struct {
     ui_message_t msg;
@@ -83,11 +40,10 @@ typedef struct {
     int idx;
     int total;
     int vertical_offset;
-    int content_height; // Pre-calculated in update
+    ui_text_layout_t layout; // 正文断行缓存，仅在消息/字体/宽度变化时重建
 } msg_render_ctx_t;
 
 static msg_render_ctx_t s_ctx;
-static int s_cached_msg_idx = -1; // 用于避免重复计算高度
 
 static uint32_t update(void) {
     int count = ui_get_message_count();
@@ -110,21 +66,22 @@ static uint32_t update(void) {
     s_ctx.valid = (msg != NULL);
 
     if (msg) {
-        // 标记已读
-        if (!msg->is_read) {
-            msg->is_read = true;
-        }
-        
+        // 标记已读（持久化随待写队列由 ui_flush_pending_saves 一并提交）
+        ui_mark_message_read(idx);
+
+        // 正文未变且排版参数一致时沿用缓存的断行结果
+        bool text_changed = (strcmp(s_ctx.msg.text, msg->text) != 0);
+
         // 复制消息内容
         s_ctx.msg = *msg; // 结构体复制
 
-        // 优化：仅在消息切换时计算高度
-        if (idx != s_cached_msg_idx) {
-            const int area_width = 128 - 2 - 4;
-            s_content_height = calculate_content_height(msg->text, area_width);
-            s_cached_msg_idx = idx;
+        if (text_changed ||
+            !ui_text_layout_matches(&s_ctx.layout, u8g2_font_wqy12_t_gb2312a, CONTENT_WIDTH)) {
+            ui_text_layout_build(&s_ctx.layout, s_ctx.msg.text,
+                                 u8g2_font_wqy12_t_gb2312a, CONTENT_WIDTH, LINE_HEIGHT);
+            ESP_LOGD(TAG, "Layout rebuilt: idx=%d lines=%d height=%d",
+                     idx, s_ctx.layout.line_count, s_ctx.layout.total_height);
         }
-        s_ctx.content_height = s_content_height;
     }
 
     return 1000;
@@ -134,12 +91,11 @@ static void render(void) {
     if (!s_ctx.valid) return;
     
     // 使用 s_ctx 中的数据进行渲染，不再调用 ui_get_message_at
-    // 也不再实时计算高度，直接使用 s_ctx.content_height
+    // 断行结果来自 update 中缓存的 s_ctx.layout，渲染只遍历行偏移
     
     board_display_begin();
     board_display_set_font(u8g2_font_wqy12_t_gb2312a);
     
-    // ... (渲染代码调整为使用 s_ctx)
     // 顶部状态栏
     board_display_rect(0, 12, 128, 1, true);
     
@@ -161,70 +117,20 @@ static void render(void) {
     board_display_rect(0, 27, 128, 1, true);
     
     // 消息内容区域
-    const int left = 2;
-    // const int right = 4;
-    // const int area_width = 128 - left - right;
     const int visible_height = 64 - CONTENT_START_Y;
+    const int content_height = s_ctx.layout.total_height;
     
-    const char *p = s_ctx.msg.text;
-    int y = CONTENT_START_Y - s_ctx.vertical_offset;
-    char line_buf[128];
-    
-    // ... (保持原有的分行渲染逻辑，但数据源为 s_ctx.msg.text)
-    while (*p) {
-        // ... (原逻辑)
-        int pos = 0;
-        int i = 0;
-        while (p[i] != '\0') {
-             // ... (复制原逻辑)
-            unsigned char c = (unsigned char)p[i];
-            int char_len = 1;
-            if (c < 0x80) char_len = 1;
-            else if ((c & 0xE0) == 0xC0) char_len = 2;
-            else if ((c & 0xF0) == 0xE0) char_len = 3;
-            else if ((c & 0xF8) == 0xF0) char_len = 4;
-
-            if (pos + char_len >= (int)sizeof(line_buf) - 1) break;
-            memcpy(&line_buf[pos], &p[i], char_len);
-            pos += char_len;
-            line_buf[pos] = '\0';
-
-            int w = board_display_text_width(line_buf);
-            if (w > (128 - 2 - 4)) {
-                while (pos > 0 && ((unsigned char)line_buf[pos-1] & 0xC0) == 0x80) pos--;
-                if (pos > 0) pos--;
-                line_buf[pos] = '\0';
-                break;
-            }
-            i += char_len;
-        }
-
-        if (pos == 0 && p[0]) {
-            unsigned char c = (unsigned char)p[0];
-            int clen = 1;
-            if ((c & 0xE0) == 0xC0) clen = 2;
-            else if ((c & 0xF0) == 0xE0) clen = 3;
-            else if ((c & 0xF8) == 0xF0) clen = 4;
-            memcpy(line_buf, p, clen);
-            line_buf[clen] = '\0';
-            i = clen;
-        }
-
-        if (y >= CONTENT_START_Y - LINE_HEIGHT && y < 64) {
-            board_display_text(left, y, line_buf);
-        }
-
-        y += LINE_HEIGHT;
-        p += (i > 0 ? i : 1);
-    }
+    ui_text_layout_draw(&s_ctx.layout, s_ctx.msg.text, CONTENT_LEFT,
+                        CONTENT_START_Y - s_ctx.vertical_offset,
+                        CONTENT_START_Y - LINE_HEIGHT, 64);
     
     // 滚动指示器
-    int max_scroll = s_ctx.content_height - visible_height;
+    int max_scroll = content_height - visible_height;
     if (max_scroll < 0) max_scroll = 0;
     
-    if (s_ctx.content_height > visible_height) {
+    if (content_height > visible_height) {
         int scrollbar_height = 64 - CONTENT_START_Y;
-        int thumb_height = (visible_height * scrollbar_height) / s_ctx.content_height;
+        int thumb_height = (visible_height * scrollbar_height) / content_height;
         if (thumb_height < 4) thumb_height = 4;
         
         int thumb_y = CONTENT_START_Y;
@@ -251,7 +157,7 @@ static void on_key(board_key_t key) {
 
     // 计算最大滚动量
     const int visible_height = 64 - CONTENT_START_Y;
-    int max_scroll = s_content_height - visible_height;
+    int max_scroll = s_ctx.layout.total_height - visible_height;
     if (max_scroll < 0) max_scroll = 0;
 
     switch (key) {
@@ -232,7 +232,6 @@ static void on_key(board_key_t key) {
         if (key == BOARD_KEY_UP) {
             // 确认解绑
             ESP_LOGI(TAG, "用户确认解绑设备");
-            extern void ble_manager_force_reset_bonds(void);
             ble_manager_force_reset_bonds();
             s_show_unbind_confirm = false;
             ui_show_toast("解绑成功，即将重启", 2000);
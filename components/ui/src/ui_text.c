@@ -3,6 +3,9 @@
 #include "u8g2.h"
 #include <string.h>
 
+/* 单行绘制缓冲：122px 宽度下一行最多约 40 个窄字符 */
+#define LAYOUT_LINE_BUF_SIZE 128
+
 // 查找 idx 之前最近的 UTF-8 字符起始位置
 static int prev_utf8_start(const char* s, int idx) {
     while (idx > 0) {
@@ -57,3 +60,89 @@ void ui_draw_text_centered(int area_x, int area_y, int area_width, const char* t
         ui_draw_text_clipped(area_x, area_y, area_width, text);
     }
 }
+
+/* ================== 多行文本排版缓存 ================== */
+
+// 解码一个 UTF-8 字符，返回其字节长度；非法或截断的序列按 1 字节处理
+static int utf8_decode(const char* s, uint16_t* out_cp) {
+    unsigned char c = (unsigned char)s[0];
+    if (c < 0x80) {
+        *out_cp = c;
+        return 1;
+    }
+    if ((c & 0xE0) == 0xC0 && s[1]) {
+        *out_cp = (uint16_t)(((c & 0x1F) << 6) | ((unsigned char)s[1] & 0x3F));
+        return 2;
+    }
+    if ((c & 0xF0) == 0xE0 && s[1] && s[2]) {
+        *out_cp = (uint16_t)(((c & 0x0F) << 12) | (((unsigned char)s[1] & 0x3F) << 6) |
+                             ((unsigned char)s[2] & 0x3F));
+        return 3;
+    }
+    if ((c & 0xF8) == 0xF0 && s[1] && s[2] && s[3]) {
+        // u8g2 字形编码为 16 位，BMP 以外的字符按 '?' 计宽
+        *out_cp = '?';
+        return 4;
+    }
+    *out_cp = '?';
+    return 1;
+}
+
+void ui_text_layout_build(ui_text_layout_t* layout, const char* text,
+                          const void* font, int width, int line_height) {
+    if (!layout) return;
+    memset(layout, 0, sizeof(*layout));
+    layout->font = font;
+    layout->width = width;
+    layout->line_height = line_height;
+    if (!text) text = "";
+
+    // 字形宽度依赖当前字体，先切换到排版字体
+    board_display_set_font(font);
+
+    int line = 0;    // 当前行索引
+    int line_w = 0;  // 当前行已累计的步进宽度
+    int pos = 0;
+    while (text[pos] != '\0') {
+        uint16_t cp;
+        int clen = utf8_decode(&text[pos], &cp);
+        int cw = board_display_glyph_width(cp);
+
+        // 行首字符即使超宽也强制放入本行，保证每行至少前进一个字符
+        if (line_w > 0 && line_w + cw > width) {
+            if (line + 1 >= UI_TEXT_LAYOUT_MAX_LINES) {
+                break;  // 超出最大行数，剩余文本不再显示
+            }
+            layout->line_start[++line] = (uint16_t)pos;
+            line_w = 0;
+        }
+        line_w += cw;
+        pos += clen;
+    }
+
+    layout->line_count = (uint8_t)(line + 1);
+    layout->line_start[layout->line_count] = (uint16_t)pos;
+    layout->total_height = layout->line_count * line_height;
+}
+
+bool ui_text_layout_matches(const ui_text_layout_t* layout, const void* font, int width) {
+    return layout && layout->line_count > 0 && layout->font == font && layout->width == width;
+}
+
+void ui_text_layout_draw(const ui_text_layout_t* layout, const char* text,
+                         int x, int y, int clip_top, int clip_bottom) {
+    if (!layout || !text) return;
+    board_display_set_font(layout->font);
+
+    char line_buf[LAYOUT_LINE_BUF_SIZE];
+    for (int i = 0; i < layout->line_count; i++, y += layout->line_height) {
+        if (y < clip_top) continue;
+        if (y >= clip_bottom) break;
+
+        size_t len = (size_t)(layout->line_start[i + 1] - layout->line_start[i]);
+        if (len >= sizeof(line_buf)) len = sizeof(line_buf) - 1;
+        memcpy(line_buf, &text[layout->line_start[i]], len);
+        line_buf[len] = '\0';
+        board_display_text(x, y, line_buf);
+    }
+}
@@ -28,19 +28,36 @@ static inline void ui_unlock(void) {
 }
 
 #define STANDBY_TIMEOUT_MS 30000  /* 30 秒后进入屏保 */
-#define BLACKSCREEN_TIMEOUT_MS 30000 /* 屏保播放 30 秒后进入黑屏 */
+#define BLACKSCREEN_TIMEOUT_MS 60000 /* 屏保播放 60 秒后关闭屏幕 */
 #define DEFAULT_BRIGHTNESS 100
 
 /* ================== 延迟 NVS 保存状态 ================== */
-/* ui_delete_current_message / ui_set_brightness 在 ui_on_key 持锁时被调用，
+/* 消息增删、已读标记与 ui_set_brightness 都在持锁期间发生，
  * 不可在锁内直接写 NVS（约 10-50ms 会阻塞 ui_tick / ui_on_key）。
- * 改为：锁内快照数据 + 设标志，由 app_loop 调用 ui_flush_pending_saves() 完成写入。 */
-static bool s_deferred_msg_save = false;
+ * 消息变更由存储层立即更新内存索引并排入待写队列，亮度在此快照；
+ * 随后通知 app_task，由其调用 ui_flush_pending_saves() 在锁外完成写入。 */
 static bool s_deferred_brightness_save = false;
-static storage_message_t s_save_snap[MAX_MESSAGES];
-static int  s_save_count;
-static int  s_save_idx;
 static uint8_t s_save_brightness;
+static void (*s_save_cb)(void) = NULL;
+
+static void ui_request_save(void) {
+    if (s_save_cb) {
+        s_save_cb();
+    }
+}
+
+/* ================== 消息窗口缓存 ================== */
+/* 收件箱正文留在 Flash 中，内存只缓存以 UI_MSG_WINDOW_SIZE 对齐的一个窗口
+ * （即列表的一页，消息页打开的消息也在其中）。窗口内访问为 O(1)，
+ * 翻页时从存储层读取一次；内存占用与消息总数无关。 */
+static ui_message_t s_window[UI_MSG_WINDOW_SIZE];
+static int s_window_start = -1;
+static int s_window_len = 0;
+
+static void msg_window_invalidate(void) {
+    s_window_start = -1;
+    s_window_len = 0;
+}
 
 /* ================== Toast 状态 ================== */
 #define TOAST_MSG_MAX 64
@@ -86,8 +103,6 @@ void ui_set_redraw_callback(void (*cb)(void)) {
 /* ================== 内部状态定义 ================== */
 typedef struct {
     ui_state_enum_t state;
-    ui_message_t messages[MAX_MESSAGES];
-    int message_count;
     int current_msg_idx;
     uint32_t last_activity_time;
     bool flashlight_on;      // 手电筒状态
@@ -96,29 +111,52 @@ typedef struct {
 
 static ui_context_t s_ui;
 
+/* ================== 屏幕休眠状态 ================== */
+/* 屏保超时后 SSD1309 进入 power-save（面板关闭、显存保留），
+ * GUI 任务不再周期唤醒，直到按键或新消息调用 ui_wake_up()。 */
+static uint32_t s_standby_enter_time = 0;
+static bool s_display_off = false;
+
 /* ================== 数据访问接口 ================== */
-int ui_get_message_count(void) { return s_ui.message_count; }
+int ui_get_message_count(void) { return storage_msglog_count(); }
 int ui_get_current_message_idx(void) { return s_ui.current_msg_idx; }
 void ui_set_current_message_idx(int idx) {
     if (s_ui.current_msg_idx != idx) {
         s_ui.current_msg_idx = idx;
-        // 优化：仅在内存中更新，不立即写 Flash
-        // storage_save_messages(s_ui.messages, s_ui.message_count, s_ui.current_msg_idx);
+        // 当前浏览位置只保存在内存中，不写 Flash
         ui_request_redraw();
     }
 }
 
 int ui_get_unread_count(void) {
-    int unread = 0;
-    for(int i=0; i<s_ui.message_count; i++) {
-        if(!s_ui.messages[i].is_read) unread++;
-    }
-    return unread;
+    return storage_msglog_unread_count();
 }
 
 ui_message_t* ui_get_message_at(int idx) {
-    if (idx < 0 || idx >= s_ui.message_count) return NULL;
-    return &s_ui.messages[idx];
+    if (idx < 0 || idx >= storage_msglog_count()) return NULL;
+
+    if (s_window_start < 0 || idx < s_window_start || idx >= s_window_start + s_window_len) {
+        // 窗口未命中：按页对齐重新装载
+        int start = idx - idx % UI_MSG_WINDOW_SIZE;
+        s_window_len = storage_msglog_read(start, UI_MSG_WINDOW_SIZE, s_window);
+        s_window_start = start;
+        if (idx >= start + s_window_len) {
+            ESP_LOGW(UI_TAG, "Failed to load message %d from storage", idx);
+            msg_window_invalidate();
+            return NULL;
+        }
+    }
+    return &s_window[idx - s_window_start];
+}
+
+void ui_mark_message_read(int idx) {
+    if (storage_msglog_mark_read(idx) != ESP_OK) return;
+    if (s_window_start >= 0 && idx >= s_window_start && idx < s_window_start + s_window_len) {
+        s_window[idx - s_window_start].is_read = true;
+    }
+    if (storage_msglog_has_pending()) {
+        ui_request_save();
+    }
 }
 
 /* ================== 辅助函数 ================== */
@@ -135,7 +173,8 @@ void ui_change_page(ui_state_enum_t new_state) {
     }
 
     // Validate transitions: do not enter message-related pages when there are no messages
-    if ((new_state == UI_STATE_MESSAGE_LIST || new_state == UI_STATE_MESSAGE_READ) && s_ui.message_count == 0) {
+    int message_count = storage_msglog_count();
+    if ((new_state == UI_STATE_MESSAGE_LIST || new_state == UI_STATE_MESSAGE_READ) && message_count == 0) {
         ESP_LOGW(UI_TAG, "Attempt to enter message page but no messages exist, redirecting to MAIN");
         new_state = UI_STATE_MAIN;
     }
@@ -143,9 +182,9 @@ void ui_change_page(ui_state_enum_t new_state) {
     // Ensure current index is within valid range when entering message pages
     if (new_state == UI_STATE_MESSAGE_LIST || new_state == UI_STATE_MESSAGE_READ) {
         if (s_ui.current_msg_idx < 0) s_ui.current_msg_idx = 0;
-        if (s_ui.current_msg_idx >= s_ui.message_count && s_ui.message_count > 0) {
+        if (s_ui.current_msg_idx >= message_count && message_count > 0) {
             // default to the most recent message for better UX
-            s_ui.current_msg_idx = s_ui.message_count - 1;
+            s_ui.current_msg_idx = message_count - 1;
         }
     }
 
@@ -183,12 +222,11 @@ void ui_init(void) {
 
     // initialize NVS storage and load persisted messages
     if (storage_init() == ESP_OK) {
-        int loaded_count = 0;
-        int loaded_idx = 0;
-        if (storage_load_messages(s_ui.messages, &loaded_count, &loaded_idx) == ESP_OK) {
-            s_ui.message_count = loaded_count;
-            s_ui.current_msg_idx = loaded_idx;
-            ESP_LOGI(UI_TAG, "Loaded %d messages from storage, current idx=%d", loaded_count, loaded_idx);
+        if (storage_msglog_load() == ESP_OK) {
+            int loaded_count = storage_msglog_count();
+            // 浏览位置不再持久化，启动后默认指向最新一条
+            s_ui.current_msg_idx = (loaded_count > 0) ? loaded_count - 1 : 0;
+            ESP_LOGI(UI_TAG, "Loaded %d messages from storage", loaded_count);
         }
         // 加载保存的亮度设置
         uint8_t saved_brightness = 0;
@@ -219,6 +257,7 @@ uint32_t ui_tick(void) {
 
     uint32_t next_sleep_ms = 1000; // 默认最大休眠时间
     bool do_render = false;
+    bool do_display_off = false;
     ui_state_enum_t render_state = s_ui.state;
 
     // 0. Toast 超时检查
@@ -249,6 +288,16 @@ uint32_t ui_tick(void) {
                 if (page_sleep < next_sleep_ms) next_sleep_ms = page_sleep;
             }
         }
+    } else if (s_display_off) {
+        // 屏幕已关闭：不渲染，无限期阻塞直到按键/消息唤醒
+        next_sleep_ms = UI_TICK_SLEEP_FOREVER;
+        s_needs_redraw = false;
+    } else if (board_time_ms() - s_standby_enter_time >= BLACKSCREEN_TIMEOUT_MS) {
+        // 屏保播放超时：关闭面板（锁外执行 I2C 命令）
+        s_display_off = true;
+        do_display_off = true;
+        next_sleep_ms = UI_TICK_SLEEP_FOREVER;
+        s_needs_redraw = false;
     } else {
         // 待机状态逻辑
         next_sleep_ms = 33; // 动画刷新率 30fps（提升流畅性）
@@ -264,7 +313,13 @@ uint32_t ui_tick(void) {
     // 3. 释放锁 (关键优化：渲染过程不持有锁，避免阻塞按键中断)
     ui_unlock();
 
-    // 4. 执行渲染 (无锁状态)
+    // 4. 关闭屏幕 (无锁状态)
+    if (do_display_off) {
+        board_display_set_power_save(true);
+        ESP_LOGI(UI_TAG, "Standby timeout, display powered off");
+    }
+
+    // 5. 执行渲染 (无锁状态)
     if (do_render) {
         if (render_state == UI_STATE_STANDBY) {
             ui_render_standby();
@@ -322,30 +377,40 @@ void ui_show_message(const char* sender, const char* text) {
 }
 
 void ui_show_message_with_timestamp(const char* sender, const char* text, uint32_t timestamp) {
-    if (!ui_lock()) {
-        ESP_LOGW(UI_TAG, "ui_show_message_with_timestamp: failed to acquire lock, message dropped");
+    ui_message_ref_t ref = { .sender = sender, .text = text, .timestamp = timestamp };
+    ui_show_messages(&ref, 1);
+}
+
+void ui_show_messages(const ui_message_ref_t* msgs, int count) {
+    if (!msgs || count <= 0) {
         return;
     }
 
-    if (s_ui.message_count >= MAX_MESSAGES) {
-        for (int i = 0; i < MAX_MESSAGES - 1; i++) {
-            s_ui.messages[i] = s_ui.messages[i + 1];
-        }
-        s_ui.message_count = MAX_MESSAGES - 1;
+    // 先在锁外清空待写队列，保证整批追加都能入队（队列满时存储层只会拒绝，不会在锁内写 NVS）
+    ui_flush_pending_saves();
+
+    if (!ui_lock()) {
+        ESP_LOGW(UI_TAG, "ui_show_messages: failed to acquire lock, %d message(s) dropped", count);
+        return;
     }
 
-    ui_message_t* msg = &s_ui.messages[s_ui.message_count++];
-    strncpy(msg->sender, sender, sizeof(msg->sender) - 1);
-    msg->sender[sizeof(msg->sender)-1] = '\0';
-    strncpy(msg->text, text, sizeof(msg->text) - 1);
-    msg->text[sizeof(msg->text)-1] = '\0';
-    msg->timestamp = timestamp;
-    msg->is_read = false;
+    // 存储层立即更新索引（满时淘汰最旧一条），记录在锁外写入
+    for (int i = 0; i < count; i++) {
+        ui_message_t msg = {0};
+        strncpy(msg.sender, msgs[i].sender, sizeof(msg.sender) - 1);
+        strncpy(msg.text, msgs[i].text, sizeof(msg.text) - 1);
+        msg.timestamp = msgs[i].timestamp;
+        msg.is_read = false;
 
-    ESP_LOGI(UI_TAG, "显示消息 - 发送者: %s, 时间戳: %u", sender, timestamp);
+        if (storage_msglog_append(&msg) != ESP_OK) {
+            ESP_LOGE(UI_TAG, "Failed to store message from %s", msgs[i].sender);
+        }
+        ESP_LOGI(UI_TAG, "显示消息 - 发送者: %s, 时间戳: %u", msgs[i].sender, msgs[i].timestamp);
+    }
+    msg_window_invalidate();
 
     ui_wake_up();
-    s_ui.current_msg_idx = s_ui.message_count - 1;
+    s_ui.current_msg_idx = storage_msglog_count() - 1;
     /* ui_change_page 会调用 ui_request_redraw */
     ui_change_page(UI_STATE_MESSAGE_READ);
     
@@ -354,23 +419,13 @@ void ui_show_message_with_timestamp(const char* sender, const char* text, uint32
     // snprintf(toast_msg, sizeof(toast_msg), "新消息来自 %s", sender);
     // ui_show_toast(toast_msg, 3000);
 
-    /* 快照消息数组以供锁外持久化
-     * NVS 写入约 10-50ms，在锁内执行会导致：
-     *   - ui_tick 等待锁超时（200ms 门限），跳过帧渲染
-     *   - ui_on_key 在按键敲击时无法及时响应
-     * 因此必须在释放锁后执行。
-     */
-    ui_message_t snap[MAX_MESSAGES];
-    int snap_count = s_ui.message_count;
-    int snap_idx   = s_ui.current_msg_idx;
-    memcpy(snap, s_ui.messages, sizeof(ui_message_t) * (size_t)snap_count);
-
     ui_unlock(); /* ─── 释放锁，以下均在无锁状态执行 ─── */
 
-    /* NVS 持久化（慢速写入，已在锁外，不阻塞 ui_tick / ui_on_key） */
-    storage_save_messages(snap, snap_count, snap_idx);
+    /* NVS 持久化（慢速写入，必须在锁外执行，否则 ui_tick 等待锁超时、按键无法及时响应）。
+     * 整批新消息与之前的删除 / 已读一起在一次刷新中追加到日志。 */
+    ui_flush_pending_saves();
 
-    /* 硬件通知（在 app_task 上下文中，安全调用） */
+    /* 硬件通知（在 app_task 上下文中，安全调用），整批只提醒一次 */
     board_notify();
     board_leds_double_flash();
     board_vibrate_double();
@@ -380,10 +435,10 @@ void ui_enter_standby(void) {
     if (s_ui.state != UI_STATE_STANDBY) {
         // 使用统一的页面切换流程以触发当前页面的 exit handler
         ui_change_page(UI_STATE_STANDBY);
-        // 恢复亮度并重置待机计时器
+        // 恢复亮度并记录进入待机的时间（用于屏保超时关屏）
         board_display_set_contrast((uint8_t)((s_ui.brightness * 255) / 100));
-        // 重置待机计时器标志（由 ui_render_standby 使用）
-        ui_render_standby_reset_timer();
+        s_standby_enter_time = board_time_ms();
+        s_display_off = false;
         // 渲染待机屏保
         ui_render_standby();
         // 进入待机时，只有手电筒未开启才关闭 LED
@@ -402,52 +457,44 @@ void ui_wake_up(void) {
     if (s_ui.state == UI_STATE_STANDBY) {
         // 强制清屏并恢复显示驱动初始状态
         // 这是必要的，因为屏保黑屏状态可能导致显示驱动出现坐标系偏移
+        // 面板关闭期间先写入黑帧（显存可写），再开屏，避免闪出旧的屏保画面
         board_display_begin();
         board_display_set_draw_color(0);
         board_display_rect(0, 0, 128, 64, true);  // 清空缓冲区
         board_display_end();
+        if (s_display_off) {
+            board_display_set_power_save(false);
+            s_display_off = false;
+        }
         
         ui_change_page(UI_STATE_MAIN);
         ui_update_activity();
         // 恢复显示驱动状态（屏保可能修改了这些状态）
         board_display_set_contrast((uint8_t)((s_ui.brightness * 255) / 100));
         board_display_set_draw_color(1);  // 恢复绘制颜色为白
-        // 重置待机计时器，以便下次进入待机时重新计时
-        ui_render_standby_reset_timer();
-        ESP_LOGI(UI_TAG, "Woke up from standby, display cleared and state restored, timer reset");
+        ESP_LOGI(UI_TAG, "Woke up from standby, display cleared and state restored");
     }
 }
 
 /* ================== 消息删除功能 ================== */
 void ui_delete_current_message(void) {
     /* 由 on_key -> ui_on_key 调用，此时 UI 互斥锁已被持有。
-     * 不得在此调用 storage_save_messages（NVS 写入 ~10-50ms 会阻塞 GUI 任务）。
-     * 改为：快照数据 + 设标志，由 app_loop 调用 ui_flush_pending_saves() 完成写入。 */
-    if (s_ui.message_count <= 0) return;
-
+     * 不得在此写 NVS（约 10-50ms 会阻塞 GUI 任务）。
+     * 改为：存储层更新索引并排入一条墓碑记录，由 app_task 调用 ui_flush_pending_saves() 写入。 */
     int idx = s_ui.current_msg_idx;
-    if (idx < 0 || idx >= s_ui.message_count) return;
-
-    // 移动后面的消息
-    for (int i = idx; i < s_ui.message_count - 1; i++) {
-        s_ui.messages[i] = s_ui.messages[i + 1];
-    }
-    s_ui.message_count--;
+    if (storage_msglog_delete(idx) != ESP_OK) return;
+    msg_window_invalidate();
 
     // 调整当前索引
-    if (s_ui.current_msg_idx >= s_ui.message_count && s_ui.message_count > 0) {
-        s_ui.current_msg_idx = s_ui.message_count - 1;
+    int remaining = storage_msglog_count();
+    if (s_ui.current_msg_idx >= remaining && remaining > 0) {
+        s_ui.current_msg_idx = remaining - 1;
     }
 
-    // 快照以供锁外持久化
-    memcpy(s_save_snap, s_ui.messages, sizeof(storage_message_t) * (size_t)s_ui.message_count);
-    s_save_count = s_ui.message_count;
-    s_save_idx   = s_ui.current_msg_idx;
-    s_deferred_msg_save = true;
-
+    ui_request_save();
     ui_request_redraw();
 
-    ESP_LOGI(UI_TAG, "Deleted message at idx %d, remaining: %d", idx, s_ui.message_count);
+    ESP_LOGI(UI_TAG, "Deleted message at idx %d, remaining: %d", idx, remaining);
 }
 
 /* ================== 手电筒功能 ================== */
@@ -487,6 +534,7 @@ void ui_set_brightness(uint8_t level) {
     // 直接写 NVS 会阻塞 GUI 任务。由 ui_flush_pending_saves() 在锁外执行。
     s_save_brightness = level;
     s_deferred_brightness_save = true;
+    ui_request_save();
 
     ui_request_redraw();
 
@@ -503,13 +551,16 @@ void ui_system_restart(void) {
 }
 
 /* ================== 延迟 NVS 持久化 ================== */
+void ui_set_save_callback(void (*cb)(void)) {
+    s_save_cb = cb;
+}
+
 void ui_flush_pending_saves(void) {
     /* 在 app_task（无锁）上下文调用，执行之前因持锁而推迟的 NVS 写入。
-     * 每次写入约 10-50ms，调用前确认不持有 UI 互斥锁。 */
-    if (s_deferred_msg_save) {
-        s_deferred_msg_save = false;
-        storage_save_messages(s_save_snap, s_save_count, s_save_idx);
-        ESP_LOGD(UI_TAG, "Deferred message save completed (%d msgs)", s_save_count);
+     * 每次写入约 10-50ms，调用前确认不持有 UI 互斥锁。
+     * 存储层写入期间只短暂持有自身的锁，GUI 任务可继续浏览与标记已读。 */
+    if (storage_msglog_has_pending()) {
+        storage_msglog_flush();
     }
     if (s_deferred_brightness_save) {
         s_deferred_brightness_save = false;
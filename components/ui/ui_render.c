@@ -10,23 +10,9 @@
 #include <time.h>
 #include <math.h>
 
-static uint32_t s_standby_start_time = 0;
-static bool s_standby_tracked = false;
-
-void ui_render_standby_reset_timer(void) {
-  s_standby_tracked = false;
-  s_standby_start_time = 0;
-}
-
-// 本文件内使用的 UTF-8 回退辅助函数（用于保证不截断字符）
-static int prev_utf8_start_local(const char *s, int idx) {
-  while (idx > 0) {
-    idx--;
-    if (((unsigned char)s[idx] & 0xC0) != 0x80)
-      break;
-  }
-  return idx;
-}
+/* 消息阅读界面的断行缓存：同一条正文只排版一次 */
+static ui_text_layout_t s_read_layout;
+static char s_read_layout_src[sizeof(((ui_message_t *)0)->text)];
 
 void ui_render_main(int message_count, int unread_count) {
   board_display_begin();
@@ -98,64 +84,18 @@ void ui_render_message_read(const ui_message_t *msg, int current_idx,
   const int line_height = 12;
   const int y_start = 38;
 
-  const char *p = msg->text;
-  int y = y_start - vertical_offset;
-  char line_buf[128];
-
-  while (*p) {
-    // 构建一行，逐字符追加直到超出像素宽度
-    int pos = 0;
-    int i = 0;
-    while (p[i] != '\0') {
-      // 找到下一个 UTF-8 字符长度
-      unsigned char c = (unsigned char)p[i];
-      int char_len = 1;
-      if (c < 0x80)
-        char_len = 1;
-      else if ((c & 0xE0) == 0xC0)
-        char_len = 2;
-      else if ((c & 0xF0) == 0xE0)
-        char_len = 3;
-      else if ((c & 0xF8) == 0xF0)
-        char_len = 4;
-
-      if (pos + char_len >= (int)sizeof(line_buf) - 1)
-        break;
-      memcpy(&line_buf[pos], &p[i], char_len);
-      pos += char_len;
-      line_buf[pos] = '\0';
-
-      // 测试当前缓冲区宽度
-      int w = board_display_text_width(line_buf);
-      if (w > area_width) {
-        // 回退到上一个 UTF-8 起点
-        pos = prev_utf8_start_local(line_buf, pos);
-        line_buf[pos] = '\0';
-        break;
-      }
-
-      i += char_len;
-    }
-
-    if (pos == 0) {
-      // 处理极端情况：单个字符宽度超过区域宽度，强制显示一个字符
-      int clen = prev_utf8_start_local(p, 1);
-      if (clen <= 0)
-        clen = 1;
-      memcpy(line_buf, p, clen);
-      line_buf[clen] = '\0';
-      i = clen;
-    }
-
-    // 只绘制可见区域内的行
-    if (y + line_height > 12 && y < 64) {
-      board_display_text(left, y, line_buf);
-    }
-
-    y += line_height;
-    p += i;
+  if (strcmp(s_read_layout_src, msg->text) != 0 ||
+      !ui_text_layout_matches(&s_read_layout, u8g2_font_wqy12_t_gb2312a, area_width)) {
+    strncpy(s_read_layout_src, msg->text, sizeof(s_read_layout_src) - 1);
+    s_read_layout_src[sizeof(s_read_layout_src) - 1] = '\0';
+    ui_text_layout_build(&s_read_layout, s_read_layout_src,
+                         u8g2_font_wqy12_t_gb2312a, area_width, line_height);
   }
 
+  // 只绘制可见区域内的行
+  ui_text_layout_draw(&s_read_layout, s_read_layout_src, left,
+                      y_start - vertical_offset, 13 - line_height, 64);
+
   // 如果消息未读，显示未读指示器
   if (!msg->is_read) {
     board_display_set_font(u8g2_font_open_iconic_check_1x_t);
@@ -168,23 +108,9 @@ void ui_render_message_read(const ui_message_t *msg, int current_idx,
 
 
 void ui_render_standby(void) {
+  /* 屏保动画超时后的关屏由 ui.c 通过 board_display_set_power_save() 处理，
+   * 此处只负责绘制动画帧 */
   uint32_t now = board_time_ms();
-  
-  // 首次进入待机时记录开始时间
-  if (!s_standby_tracked) {
-    s_standby_start_time = now;
-    s_standby_tracked = true;
-  }
-  
-  // 60 秒后进入黑屏（停止动画计算，直接显示黑屏）
-  if (now - s_standby_start_time >= 60000) {
-    board_display_begin();
-    board_display_set_draw_color(0);
-    board_display_rect(0, 0, 128, 64, true);  // 绘制全黑矩形
-    board_display_set_contrast(0);            // 关闭对比度（省电）
-    board_display_end();
-    return;
-  }
 
   board_display_begin();
 
@@ -17,7 +17,6 @@ static const char *MAIN_TAG = "MAIN_BOOT";
 #define APP_TASK_NAME        "app_task"
 #define APP_TASK_STACK_SIZE  (4096)
 #define APP_TASK_PRIORITY    (4)
-#define APP_TASK_PERIOD_MS   (10)
 
 /* ======================== 任务句柄 ======================== */
 static TaskHandle_t s_app_task_handle = NULL;
@@ -27,18 +26,12 @@ static void app_task(void* pvParameters)
 {
     (void)pvParameters;
 
-    ESP_LOGI(MAIN_TAG, "应用任务已启动 (栈：%u 字节，优先级：%u, 周期：%ums)",
-             APP_TASK_STACK_SIZE, APP_TASK_PRIORITY, APP_TASK_PERIOD_MS);
+    ESP_LOGI(MAIN_TAG, "应用任务已启动 (栈：%u 字节，优先级：%u, 事件驱动)",
+             APP_TASK_STACK_SIZE, APP_TASK_PRIORITY);
 
-    TickType_t last_wake_time = xTaskGetTickCount();
-
-    while (1) {
-        // 执行应用主循环（非阻塞）
-        app_loop();
-
-        // 使用 vTaskDelayUntil 保证周期执行
-        vTaskDelayUntil(&last_wake_time, pdMS_TO_TICKS(APP_TASK_PERIOD_MS));
-    }
+    // 事件驱动主循环，不返回
+    app_run();
+    vTaskDelete(NULL);
 }
 
 /* ===================== NVS 初始化 ===================== */